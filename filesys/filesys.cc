@@ -82,8 +82,10 @@ FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
 
-    directoryLock = new ReadWriteLock();
-    fileLock = new ReadWriteLock();
+    // Creates and removes are few next to lookups, and shouldn't wait
+    // behind them; file reads and writes take turns.
+    directoryLock = new ReadWriteLock("directory lock", WriterPreferring);
+    fileLock = new ReadWriteLock("file lock", PhaseFair);
 
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
@@ -24,7 +24,7 @@
 //----------------------------------------------------------------------
 
 static void
-DiskRequestDone (int arg)
+DiskRequestDone (PtrInt arg)
 {
     SynchDisk* disk = (SynchDisk *)arg;
 
@@ -44,7 +44,7 @@ SynchDisk::SynchDisk(char* name)
 {
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (int) this);
+    disk = new Disk(name, DiskRequestDone, (PtrInt) this);
 }
 
 //----------------------------------------------------------------------
@@ -18,10 +18,14 @@
 #include "system.h"
 
 // Dummy functions because C++ is weird about pointers to member functions
-static void ConsoleReadPoll(int c) 
+static void ConsoleReadPoll(PtrInt c) 
 { Console *console = (Console *)c; console->CheckCharAvail(); }
-static void ConsoleWriteDone(int c)
+static void ConsoleWriteDone(PtrInt c)
 { Console *console = (Console *)c; console->WriteDone(); }
+#ifdef CHANGED
+static void ConsoleInputReady(PtrInt c)
+{ interrupt->Schedule(ConsoleReadPoll, c, ConsoleTime, ConsoleReadInt); }
+#endif
 
 //----------------------------------------------------------------------
 // Console::Console
@@ -34,10 +38,16 @@ static void ConsoleWriteDone(int c)
 // 	"writeDone" is the interrupt handler called when a character has
 //		been output, so that it is ok to request the next char be
 //		output
+//	"bulk" -- read the keyboard a run of characters at a time, for
+//		GetChars, rather than a character per interrupt
 //----------------------------------------------------------------------
 
 Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail, 
-		VoidFunctionPtr writeDone, int callArg)
+		VoidFunctionPtr writeDone, PtrInt callArg
+#ifdef CHANGED
+		, bool bulk
+#endif
+		)
 {
     if (readFile == NULL)
 	readFileNo = 0;					// keyboard = stdin
@@ -54,9 +64,21 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     handlerArg = callArg;
     putBusy = FALSE;
     incoming = EOF;
-
+#ifdef CHANGED
+    putCount = 0;
+    bulkInput = bulk;
+    inHead = inCount = 0;
+#endif
+
+#ifdef CHANGED
+    // wait for keystrokes; the reactor tells us when they arrive, and
+    // we take the usual ConsoleTime to deliver them.  A plain input
+    // file is always ready, so that is polled as before.
+    inputRegistered = RegisterInput(readFileNo, ConsoleInputReady, (PtrInt)this);
+    if (!inputRegistered)
+#endif
     // start polling for incoming packets
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, ConsoleReadInt);
+    interrupt->Schedule(ConsoleReadPoll, (PtrInt)this, ConsoleTime, ConsoleReadInt);
 }
 
 //----------------------------------------------------------------------
@@ -66,6 +88,10 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
 
 Console::~Console()
 {
+#ifdef CHANGED
+    if (inputRegistered)
+	UnregisterInput(readFileNo);
+#endif
     if (readFileNo != 0)
 	Close(readFileNo);
     if (writeFileNo != 1)
@@ -88,10 +114,42 @@ Console::CheckCharAvail()
 {
     char c;
 
+#ifdef CHANGED
+    // with the reactor, we only get here once input has arrived; but
+    // if the last of it hasn't been taken yet, try again later
+    if (inputRegistered) {
+	if ((incoming != EOF) || (inCount > 0)) {
+	    interrupt->Schedule(ConsoleReadPoll, (PtrInt)this, ConsoleTime,
+			ConsoleReadInt);
+	    return;
+	}
+	RearmInput(readFileNo);
+    } else
+#endif
     // schedule the next time to poll for a packet
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, 
+    interrupt->Schedule(ConsoleReadPoll, (PtrInt)this, ConsoleTime, 
 			ConsoleReadInt);
 
+#ifdef CHANGED
+    if (bulkInput) {
+	// as below, but take everything that's ready, up to a buffer full
+	if ((inCount > 0) || !PollFile(readFileNo))
+	    return;
+	inCount = ReadPartial(readFileNo, inBuffer, ConsoleBufferSize);
+	if (inCount <= 0) {		// end of the input file
+	    inCount = 0;
+	    if (inputRegistered)	// nothing more will come
+		UnregisterInput(readFileNo);
+	    inputRegistered = FALSE;
+	    return;
+	}
+	inHead = 0;
+	stats->numConsoleCharsRead += inCount;
+	(*readHandler)(handlerArg);
+	return;
+    }
+#endif
+
     // do nothing if character is already buffered, or none to be read
     if ((incoming != EOF) || !PollFile(readFileNo))
 	return;	  
@@ -114,7 +172,11 @@ void
 Console::WriteDone()
 {
     putBusy = FALSE;
+#ifdef CHANGED
+    stats->numConsoleCharsWritten += putCount;
+#else
     stats->numConsoleCharsWritten++;
+#endif
     (*writeHandler)(handlerArg);
 }
 
@@ -145,6 +207,47 @@ Console::PutChar(char ch)
     ASSERT(putBusy == FALSE);
     WriteFile(writeFileNo, &ch, sizeof(char));
     putBusy = TRUE;
-    interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
+#ifdef CHANGED
+    putCount = 1;
+#endif
+    interrupt->Schedule(ConsoleWriteDone, (PtrInt)this, ConsoleTime,
+					ConsoleWriteInt);
+}
+
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Console::PutChars()
+// 	Write "count" characters to the simulated display with one host
+//	write, and schedule a single interrupt for the whole transfer.
+//----------------------------------------------------------------------
+
+void
+Console::PutChars(char *data, int count)
+{
+    ASSERT(putBusy == FALSE);
+    ASSERT(count > 0 && count <= ConsoleBufferSize);
+    WriteFile(writeFileNo, data, count);
+    putBusy = TRUE;
+    putCount = count;
+    interrupt->Schedule(ConsoleWriteDone, (PtrInt)this, ConsoleTime,
 					ConsoleWriteInt);
 }
+
+//----------------------------------------------------------------------
+// Console::GetChars()
+// 	Copy up to "max" characters that have arrived into "into", and
+//	return how many.  Once every character of a run has been taken,
+//	the next poll can read another.
+//----------------------------------------------------------------------
+
+int
+Console::GetChars(char *into, int max)
+{
+    int count = min(max, inCount);
+
+    bcopy(&inBuffer[inHead], into, count);
+    inHead += count;
+    inCount -= count;
+    return count;
+}
+#endif
@@ -35,10 +35,18 @@
 // The interrupt handler "writeDone" is called when an output character 
 // has been "put", so that the next character can be written.
 
+#ifdef CHANGED
+#define ConsoleBufferSize 128	// most bytes moved by one bulk transfer
+#endif
+
 class Console {
   public:
     Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail, 
-	VoidFunctionPtr writeDone, int callArg);
+	VoidFunctionPtr writeDone, PtrInt callArg
+#ifdef CHANGED
+	, bool bulk = FALSE
+#endif
+	);
 				// initialize the hardware console device
     ~Console();			// clean up console emulation
 
@@ -52,6 +60,18 @@ class Console {
     				// "readHandler" is called whenever there is 
 				// a char to be gotten
 
+#ifdef CHANGED
+    void PutChars(char *data, int count);
+				// Write up to ConsoleBufferSize chars as a
+				// single transfer; "writeHandler" is called
+				// once, when all of them are out.
+    int GetChars(char *into, int max);
+				// Take up to "max" of the chars that have
+				// arrived.  In "bulk" mode the keyboard is
+				// read a run of chars at a time, with one
+				// "readHandler" call per run.
+#endif
+
 // internal emulation routines -- DO NOT call these. 
     void WriteDone();	 	// internal routines to signal I/O completion
     void CheckCharAvail();
@@ -63,13 +83,21 @@ class Console {
 					// the PutChar I/O completes
     VoidFunctionPtr readHandler; 	// Interrupt handler to call when 
 					// a character arrives from the keyboard
-    int handlerArg;			// argument to be passed to the 
+    PtrInt handlerArg;			// argument to be passed to the 
 					// interrupt handlers
     bool putBusy;    			// Is a PutChar operation in progress?
 					// If so, you can't do another one!
     char incoming;    			// Contains the character to be read,
 					// if there is one available. 
 					// Otherwise contains EOF.
+#ifdef CHANGED
+    int putCount;			// chars in the transfer in progress
+    bool bulkInput;			// read runs of chars into "inBuffer"
+    char inBuffer[ConsoleBufferSize];	// chars read but not yet gotten
+    int inHead, inCount;
+    bool inputRegistered;		// the reactor tells us about input,
+					// rather than our polling for it
+#endif
 };
 
 #endif // CONSOLE_H
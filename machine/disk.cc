@@ -26,7 +26,7 @@
 #define DiskSize 	(MagicSize + (NumSectors * SectorSize))
 
 // dummy procedure because we can't take a pointer of a member function
-static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
+static void DiskDone(PtrInt arg) { ((Disk *)arg)->HandleInterrupt(); }
 
 //----------------------------------------------------------------------
 // Disk::Disk()
@@ -40,12 +40,13 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 //	"callArg" -- argument to pass the interrupt handler
 //----------------------------------------------------------------------
 
-Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
+Disk::Disk(char* name, VoidFunctionPtr callWhenDone, PtrInt callArg)
 {
     int magicNum;
     int tmp = 0;
 
-    DEBUG('d', "Initializing the disk, 0x%x 0x%x\n", callWhenDone, callArg);
+    DEBUG('d', "Initializing the disk, %p 0x%lx\n", (void *) callWhenDone,
+	  (long) callArg);
     handler = callWhenDone;
     handlerArg = callArg;
     lastSector = 0;
@@ -129,7 +130,7 @@ Disk::ReadRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskReads++;
-    interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
+    interrupt->Schedule(DiskDone, (PtrInt) this, ticks, DiskInt);
 }
 
 void
@@ -149,7 +150,7 @@ Disk::WriteRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskWrites++;
-    interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
+    interrupt->Schedule(DiskDone, (PtrInt) this, ticks, DiskInt);
 }
 
 //----------------------------------------------------------------------
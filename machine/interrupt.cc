@@ -23,12 +23,24 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "system.h"
+#ifdef CHANGED
+#include "synch.h"
+#ifdef USER_PROGRAM
+extern void ProcessUsageReport();
+#endif
+#endif
 
 // String definitions for debugging messages
 
 static char *intLevelNames[] = { "off", "on"};
+#ifdef CHANGED
+static char *intTypeNames[] = { "timer", "disk", "console write", 
+			"console read", "network send", "network recv",
+			"alarm"};
+#else
 static char *intTypeNames[] = { "timer", "disk", "console write", 
 			"console read", "network send", "network recv"};
+#endif
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -41,13 +53,18 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //	"kind" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
 
-PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time, 
+PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, PtrInt param, int time, 
 				IntType kind)
 {
     handler = func;
     arg = param;
     when = time;
     type = kind;
+#ifdef CHANGED
+    seq = 0;
+    heapIndex = -1;
+    nextFree = NULL;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -60,10 +77,21 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
+#ifdef CHANGED
+    pendingCapacity = 16;
+    pending = new PendingInterrupt*[pendingCapacity];
+    numPending = 0;
+    nextSeq = 0;
+    freeEvents = NULL;
+#else
     pending = new List();
+#endif
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+#ifdef CHANGED
+    nextInputPoll = 0;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -73,9 +101,20 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
+#ifdef CHANGED
+    while (numPending > 0)
+	delete HeapRemove(0);
+    delete [] pending;
+    while (freeEvents != NULL) {
+	PendingInterrupt *next = freeEvents->nextFree;
+	delete freeEvents;
+	freeEvents = next;
+    }
+#else
     while (!pending->IsEmpty())
 	delete pending->Remove();
     delete pending;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -153,6 +192,27 @@ Interrupt::OneTick()
     MachineStatus old = status;
 
 // advance simulated time
+#ifdef CHANGED
+    int ticks = (status == SystemMode) ? SystemTick : UserTick;
+
+    if (status == SystemMode) {
+	stats->systemTicks += ticks;
+	currentThread->Account(0, ticks, 0, 0);
+    } else {					// USER_PROGRAM
+	stats->userTicks += ticks;
+	currentThread->Account(ticks, 0, 0, 0);
+    }
+    if (numCpus > 1) {			// the machine has got as far as
+	Cpu *earliest;			// the CPU furthest behind
+	currentCpu->clock += ticks;
+	if (!currentCpu->idle)
+	    currentCpu->busyTicks += ticks;
+	earliest = EarliestCpu();
+	if (earliest != NULL && earliest->clock > stats->totalTicks)
+	    stats->totalTicks = earliest->clock;
+    } else
+	stats->totalTicks += ticks;
+#else
     if (status == SystemMode) {
         stats->totalTicks += SystemTick;
 	stats->systemTicks += SystemTick;
@@ -160,14 +220,31 @@ Interrupt::OneTick()
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
     }
+#endif
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
 					// (interrupt handlers run with
 					// interrupts disabled)
+#ifdef CHANGED
+    if (stats->totalTicks >= nextInputPoll) {	// has any host input
+	CheckInput(FALSE);			// arrived?  Check about as
+	nextInputPoll = stats->totalTicks + ConsoleTime;  // often as the
+    }						// devices used to poll
+#endif
     while (CheckIfDue(FALSE))		// check for pending interrupts
 	;
+#ifdef CHANGED
+    if (numCpus > 1) {			// let a CPU that's fallen behind
+	Cpu *next = EarliestCpu();	// catch up
+	if (next != NULL && next != currentCpu && (currentCpu->idle
+			|| currentCpu->clock - next->clock >= CpuSkew))
+	    SwitchCpu(next);
+	if (currentThread == currentCpu->idleThread)
+	    yieldOnReturn = FALSE;	// it gives way to anything anyway
+    }
+#endif
     ChangeLevel(IntOff, IntOn);		// re-enable interrupts
     if (yieldOnReturn) {		// if the timer device handler asked 
 					// for a context switch, ok to do it now
@@ -178,6 +255,78 @@ Interrupt::OneTick()
     }
 }
 
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Interrupt::SendIPI
+// 	Send an inter-processor interrupt, telling "cpu" to look at the
+//	ready queue: an idle CPU is woken up, and a busy one gives up
+//	its thread, as on a time slice, once the simulation gets to it.
+//	Interrupts must be off.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SendIPI(Cpu *cpu)
+{
+    ASSERT(level == IntOff);
+    DEBUG('i', "IPI to CPU %d\n", cpu->id);
+    cpu->ipis++;
+    if (cpu->idle)
+	cpu->Wake();
+    else if (cpu == currentCpu)
+	yieldOnReturn = TRUE;
+    else
+	cpu->yieldOnReturn = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SwitchCpu
+// 	Stop simulating this CPU and simulate "to" instead.  Its thread,
+//	and its interrupt state, take over the machine, and its host
+//	thread takes over the simulation, until some CPU switches back to
+//	this one; then we return.  Interrupts must be
+//	off, as they are wherever a CPU could take an interrupt.
+//
+//	This is like Scheduler::Run, except that neither thread stops
+//	running: each stays on its own CPU.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SwitchCpu(Cpu *to)
+{
+    Cpu *from = currentCpu;
+    Thread *oldThread = currentThread;
+
+    ASSERT(level == IntOff && to != from);
+#ifdef USER_PROGRAM
+    if (oldThread->space != NULL) {	// the other CPU has registers
+	oldThread->SaveUserState();	// of its own
+	oldThread->space->SaveState();
+    }
+#endif
+    from->current = oldThread;
+    from->status = status;
+    from->yieldOnReturn = yieldOnReturn;
+
+    currentCpu = to;
+    currentThread = to->current;
+    status = to->status;
+    yieldOnReturn = to->yieldOnReturn;
+    to->switchedTo++;
+    DEBUG('i', "Switching from CPU %d to CPU %d, at %d and %d\n",
+	  from->id, to->id, from->clock, to->clock);
+
+    from->HandOff(to);
+
+    ASSERT(currentThread == oldThread && currentCpu == from);
+#ifdef USER_PROGRAM
+    if (currentThread->space != NULL) {
+	currentThread->RestoreUserState();
+	currentThread->space->RestoreState();
+    }
+#endif
+}
+#endif
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -204,6 +353,9 @@ Interrupt::YieldOnReturn()
 //	on the ready queue, the only thing to do is to advance 
 //	simulated time until the next scheduled hardware interrupt.
 //
+//	If there are no pending interrupts, but a device is waiting
+//	for input, sleep in the host until the input arrives.
+//
 //	If there are no pending interrupts, stop.  There's nothing
 //	more for us to do.
 //----------------------------------------------------------------------
@@ -212,6 +364,9 @@ Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+#ifdef CHANGED
+    CheckInput(FALSE);			// input may have arrived already
+#endif
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
 	    ;				// interrupts
@@ -222,10 +377,20 @@ Interrupt::Idle()
 					// a runnable thread
     }
 
+#ifdef CHANGED
+    if (WaitingForInput()) {		// the device handler will schedule
+	DEBUG('i', "Machine idle.  Waiting for input.\n");
+	CheckInput(TRUE);		// an interrupt for the input; we
+	status = SystemMode;		// run it on the next call
+	return;
+    }
+#endif
+
     // if there are no pending interrupts, and nothing is on the ready
     // queue, it is time to stop.   If the console or the network is 
-    // operating, there are *always* pending interrupts, so this code
-    // is not reached.  Instead, the halt must be invoked by the user program.
+    // operating, we wait for input above (or, polling a plain file,
+    // there are *always* pending interrupts), so this code is not
+    // reached.  Instead, the halt must be invoked by the user program.
 
     DEBUG('i', "Machine idle.  No interrupts to do.\n");
     printf("No threads ready or runnable, and no pending interrupts.\n");
@@ -242,9 +407,205 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+#ifdef CHANGED
+    scheduler->Report();
+#ifdef USER_PROGRAM
+    if (scheduler->isReporting())
+	ProcessUsageReport();
+#endif
+    if (DebugIsEnabled('t'))
+	threadPool->Print();
+    if (numCpus > 1)
+	for (int i = 0; i < numCpus; i++)
+	    cpus[i]->Print();
+    if (lockProfile)
+	SyncProfile::Report();
+#endif
     Cleanup();     // Never returns.
 }
 
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Interrupt::Schedule
+// 	Arrange for the CPU to be interrupted when simulated time
+//	reaches "now + when".
+//
+//	Implementation: put it on a binary heap, so that scheduling an
+//	interrupt and taking off the next one to fire are O(log n) in
+//	the number pending.  The PendingInterrupt comes off the free
+//	list if there is one there.
+//
+//	NOTE: the Nachos kernel should not call this routine directly.
+//	Instead, it is only called by the hardware device simulators.
+//
+//	"handler" is the procedure to call when the interrupt occurs
+//	"arg" is the argument to pass to the procedure
+//	"fromNow" is how far in the future (in simulated time) the 
+//		 interrupt is to occur
+//	"type" is the hardware device that generated the interrupt
+//
+// Returns:
+//	A handle that can be passed to Cancel.
+//----------------------------------------------------------------------
+
+InterruptHandle
+Interrupt::Schedule(VoidFunctionPtr handler, PtrInt arg, int fromNow, IntType type)
+{
+    int when = stats->totalTicks + fromNow;
+    PendingInterrupt *toOccur;
+    InterruptHandle handle;
+
+    DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
+					intTypeNames[type], when);
+    ASSERT(fromNow > 0);
+
+    if (freeEvents != NULL) {
+	toOccur = freeEvents;
+	freeEvents = toOccur->nextFree;
+	toOccur->handler = handler;
+	toOccur->arg = arg;
+	toOccur->when = when;
+	toOccur->type = type;
+    } else
+	toOccur = new PendingInterrupt(handler, arg, when, type);
+    toOccur->seq = nextSeq++;
+    HeapInsert(toOccur);
+
+    handle.event = toOccur;
+    handle.seq = toOccur->seq;
+    return handle;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Take an interrupt that was scheduled off the pending heap, so
+//	that it never fires.
+//
+// Returns:
+//	FALSE if it had already fired (or been cancelled), including if
+//	it is the interrupt whose handler is running now.
+//
+//	"handle" is what Schedule returned.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Cancel(InterruptHandle handle)
+{
+    PendingInterrupt *toCancel = handle.event;
+
+    if (toCancel == NULL || toCancel->seq != handle.seq
+				|| toCancel->heapIndex < 0)
+	return FALSE;
+    DEBUG('i', "Cancelling interrupt handler the %s at time = %d\n", 
+			intTypeNames[toCancel->type], toCancel->when);
+    HeapRemove(toCancel->heapIndex);
+    toCancel->nextFree = freeEvents;
+    freeEvents = toCancel;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// EarlierEvent
+// 	The pending heap's order: by time, and then by when they were
+//	scheduled.  Sequence numbers are allowed to wrap around.
+//----------------------------------------------------------------------
+
+static bool
+EarlierEvent(PendingInterrupt *a, PendingInterrupt *b)
+{
+    if (a->when != b->when)
+	return a->when < b->when;
+    return (int)(a->seq - b->seq) < 0;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SiftUp, Interrupt::SiftDown
+// 	Move pending[i] up or down the heap to where it belongs, keeping
+//	each interrupt's heapIndex up to date.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SiftUp(int i)
+{
+    PendingInterrupt *toOccur = pending[i];
+
+    while (i > 0) {
+	int parent = (i - 1) / 2;
+	if (!EarlierEvent(toOccur, pending[parent]))
+	    break;
+	pending[i] = pending[parent];
+	pending[i]->heapIndex = i;
+	i = parent;
+    }
+    pending[i] = toOccur;
+    toOccur->heapIndex = i;
+}
+
+void
+Interrupt::SiftDown(int i)
+{
+    PendingInterrupt *toOccur = pending[i];
+
+    for (;;) {
+	int child = 2 * i + 1;
+	if (child >= numPending)
+	    break;
+	if (child + 1 < numPending
+		&& EarlierEvent(pending[child + 1], pending[child]))
+	    child++;
+	if (!EarlierEvent(pending[child], toOccur))
+	    break;
+	pending[i] = pending[child];
+	pending[i]->heapIndex = i;
+	i = child;
+    }
+    pending[i] = toOccur;
+    toOccur->heapIndex = i;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::HeapInsert
+// 	Add an interrupt to the pending heap, growing it if need be.
+//----------------------------------------------------------------------
+
+void
+Interrupt::HeapInsert(PendingInterrupt *toOccur)
+{
+    if (numPending == pendingCapacity) {
+	PendingInterrupt **bigger = new PendingInterrupt*[2 * pendingCapacity];
+	for (int i = 0; i < numPending; i++)
+	    bigger[i] = pending[i];
+	delete [] pending;
+	pending = bigger;
+	pendingCapacity *= 2;
+    }
+    pending[numPending++] = toOccur;
+    SiftUp(numPending - 1);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::HeapRemove
+// 	Take pending[i] off the heap -- the next to fire, if i is 0 --
+//	and fill its place with the last one.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+Interrupt::HeapRemove(int i)
+{
+    PendingInterrupt *toOccur = pending[i];
+
+    ASSERT(i >= 0 && i < numPending);
+    numPending--;
+    if (i < numPending) {
+	pending[i] = pending[numPending];
+	pending[i]->heapIndex = i;
+	SiftDown(i);
+	SiftUp(pending[i]->heapIndex);
+    }
+    toOccur->heapIndex = -1;
+    return toOccur;
+}
+#else
 //----------------------------------------------------------------------
 // Interrupt::Schedule
 // 	Arrange for the CPU to be interrupted when simulated time
@@ -262,7 +623,7 @@ Interrupt::Halt()
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
 void
-Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
+Interrupt::Schedule(VoidFunctionPtr handler, PtrInt arg, int fromNow, IntType type)
 {
     int when = stats->totalTicks + fromNow;
     PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
@@ -274,6 +635,8 @@ Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
     pending->SortedInsert(toOccur, when);
 }
 
+#endif
+
 //----------------------------------------------------------------------
 // Interrupt::CheckIfDue
 // 	Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -297,6 +660,22 @@ Interrupt::CheckIfDue(bool advanceClock)
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
+#ifdef CHANGED
+    // Look before taking it off: this is called on every tick, and
+    // usually nothing is due yet.
+    if (numPending == 0)		// no pending interrupts
+	return FALSE;
+    if (!advanceClock && pending[0]->when > stats->totalTicks)
+	return FALSE;			// not time yet
+    PendingInterrupt *toOccur = HeapRemove(0);
+
+    when = toOccur->when;
+
+    if (when > stats->totalTicks) {	// advance the clock
+	stats->idleTicks += (when - stats->totalTicks);
+	stats->totalTicks = when;
+    }
+#else
     PendingInterrupt *toOccur = 
 		(PendingInterrupt *)pending->SortedRemove(&when);
 
@@ -310,13 +689,23 @@ Interrupt::CheckIfDue(bool advanceClock)
 	pending->SortedInsert(toOccur, when);
 	return FALSE;
     }
+#endif
 
 // Check if there is nothing more to do, and if so, quit
+#ifdef CHANGED
+    // (periodic threads waiting for their next release need the timer)
+    if (((status == IdleMode) && !(nohalt)) && (toOccur->type == TimerInt) 
+		&& numPending == 0 && !scheduler->RealTimeWaiting()) {
+	 HeapInsert(toOccur);
+	 return FALSE;
+    }
+#else
     if (((status == IdleMode) && !(nohalt)) && (toOccur->type == TimerInt) 
 				&& pending->IsEmpty()) {
 	 pending->SortedInsert(toOccur, when);
 	 return FALSE;
     }
+#endif
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
@@ -331,7 +720,12 @@ Interrupt::CheckIfDue(bool advanceClock)
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
+#ifdef CHANGED
+    toOccur->nextFree = freeEvents;	// recycle it, for the next Schedule
+    freeEvents = toOccur;
+#else
     delete toOccur;
+#endif
     return TRUE;
 }
 
@@ -342,7 +736,7 @@ Interrupt::CheckIfDue(bool advanceClock)
 //----------------------------------------------------------------------
 
 static void
-PrintPending(int arg)
+PrintPending(PtrInt arg)
 {
     PendingInterrupt *pend = (PendingInterrupt *)arg;
 
@@ -363,7 +757,12 @@ Interrupt::DumpState()
 					intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
+#ifdef CHANGED
+    for (int i = 0; i < numPending; i++)	// in heap order, not
+	PrintPending((PtrInt)pending[i]);	// necessarily time order
+#else
     pending->Mapcar(PrintPending);
+#endif
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
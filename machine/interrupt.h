@@ -38,6 +38,10 @@
 #include "copyright.h"
 #include "list.h"
 
+#ifdef CHANGED
+class Cpu;
+#endif
+
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff, IntOn };
 
@@ -49,8 +53,15 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
 // display and keyboard, and a network.
+#ifdef CHANGED
+// There is also a one-shot alarm, for kernel threads that sleep (see
+// threads/alarm.h).
+enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
+				NetworkSendInt, NetworkRecvInt, AlarmInt};
+#else
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 				NetworkSendInt, NetworkRecvInt};
+#endif
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -58,16 +69,37 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(VoidFunctionPtr func, int param, int time, IntType kind);
+    PendingInterrupt(VoidFunctionPtr func, PtrInt param, int time, IntType kind);
 				// initialize an interrupt that will
 				// occur in the future
 
     VoidFunctionPtr handler;    // The function (in the hardware device
 				// emulator) to call when the interrupt occurs
-    int arg;                    // The argument to the function.
+    PtrInt arg;                 // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+#ifdef CHANGED
+    unsigned int seq;		// order of scheduling, to break ties and
+				// to tell a stale handle from a live one
+    int heapIndex;		// where we are in the pending heap, or -1
+    PendingInterrupt *nextFree;	// on the free list, once fired
+#endif
+};
+
+#ifdef CHANGED
+// What Interrupt::Schedule hands back, so that the interrupt can be
+// cancelled before it fires.  Pending interrupts are recycled rather
+// than deleted, and each is stamped afresh when it is scheduled, so a
+// handle that has outlived its interrupt is harmless: cancelling it
+// does nothing.
+class InterruptHandle {
+  public:
+    InterruptHandle() { event = NULL; seq = 0; }
+
+    PendingInterrupt *event;
+    unsigned int seq;		// event->seq when it was scheduled
 };
+#endif
 
 // The following class defines the data structures for the simulation
 // of hardware interrupts.  We record whether interrupts are enabled
@@ -94,6 +126,17 @@ class Interrupt {
     
     void YieldOnReturn();		// cause a context switch on return 
 					// from an interrupt handler
+#ifdef CHANGED
+    void YieldSoon() { yieldOnReturn = TRUE; }
+					// the same, but from anywhere: the
+					// switch happens on the next tick
+					// with interrupts enabled
+
+    void SendIPI(Cpu *cpu);		// with more than one CPU: have
+					// "cpu" look at the ready queue
+    void SwitchCpu(Cpu *to);		// simulate another CPU until this
+					// one's turn comes round again
+#endif
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
     void setStatus(MachineStatus st) { status = st; }
@@ -106,19 +149,49 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
+#ifdef CHANGED
+    InterruptHandle Schedule(VoidFunctionPtr handler,// Schedule an interrupt
+	PtrInt arg, int when, IntType type);// to occur at time ``when''.
+					// This is called by the hardware
+					// device simulators.
+    bool Cancel(InterruptHandle handle);// Unschedule it again; FALSE if
+					// it has already fired
+#else
     void Schedule(VoidFunctionPtr handler,// Schedule an interrupt to occur
-	int arg, int when, IntType type);// at time ``when''.  This is called
+	PtrInt arg, int when, IntType type);// at time ``when''.  This is called
     					// by the hardware device simulators.
+#endif
     
     void OneTick();       		// Advance simulated time
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
+#ifdef CHANGED
+    PendingInterrupt **pending;	// the interrupts scheduled to occur in
+				// the future: a min-heap on when (and
+				// seq, so ties fire in FIFO order)
+    int numPending;
+    int pendingCapacity;
+    unsigned int nextSeq;
+    PendingInterrupt *freeEvents;	// fired or cancelled, for reuse
+
+    void HeapInsert(PendingInterrupt *toOccur);
+    PendingInterrupt *HeapRemove(int i);// take out pending[i]
+    void SiftUp(int i);
+    void SiftDown(int i);
+
+    friend void InterruptBenchmark(int numPending, int numFires);
+					// times the heap on its own
+#else
     List *pending;		// the list of interrupts scheduled
 				// to occur in the future
+#endif
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
+#ifdef CHANGED
+    int nextInputPoll;		// when to next check for host input
+#endif
     MachineStatus status;	// idle, kernel mode, user mode
 
     // these functions are internal to the interrupt simulation code
@@ -12,17 +12,21 @@
 #include "system.h"
 
 // Dummy functions because C++ can't call member functions indirectly 
-static void NetworkReadPoll(int arg)
+static void NetworkReadPoll(PtrInt arg)
 { Network *net = (Network *)arg; net->CheckPktAvail(); }
-static void NetworkSendDone(int arg)
+static void NetworkSendDone(PtrInt arg)
 { Network *net = (Network *)arg; net->SendDone(); }
+#ifdef CHANGED
+static void NetworkInputReady(PtrInt arg)
+{ interrupt->Schedule(NetworkReadPoll, arg, NetworkTime, NetworkRecvInt); }
+#endif
 
 // Initialize the network emulation
 //   addr is used to generate the socket name
 //   reliability says whether we drop packets to emulate unreliable links
 //   readAvail, writeDone, callArg -- analogous to console
 Network::Network(NetworkAddress addr, double reliability,
-	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg)
+	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, PtrInt callArg)
 {
     ident = addr;
     if (reliability < 0) chanceToWork = 0;
@@ -41,12 +45,21 @@ Network::Network(NetworkAddress addr, double reliability,
     AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
 						 // in the current directory.
 
+#ifdef CHANGED
+    // let the reactor tell us when a packet arrives
+    bool registered = RegisterInput(sock, NetworkInputReady, (PtrInt)this);
+    ASSERT(registered);
+#else
     // start polling for incoming packets
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
+    interrupt->Schedule(NetworkReadPoll, (PtrInt)this, NetworkTime, NetworkRecvInt);
+#endif
 }
 
 Network::~Network()
 {
+#ifdef CHANGED
+    UnregisterInput(sock);
+#endif
     CloseSocket(sock);
     DeAssignNameToSocket(sockName);
 }
@@ -57,11 +70,22 @@ Network::~Network()
 void
 Network::CheckPktAvail()
 {
+#ifdef CHANGED
+    // a packet has arrived; if the last one is still buffered, try
+    // again later
+    if (inHdr.length != 0) {
+	interrupt->Schedule(NetworkReadPoll, (PtrInt)this, NetworkTime,
+			NetworkRecvInt);
+	return;
+    }
+    RearmInput(sock);
+#else
     // schedule the next time to poll for a packet
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
+    interrupt->Schedule(NetworkReadPoll, (PtrInt)this, NetworkTime, NetworkRecvInt);
 
     if (inHdr.length != 0) 	// do nothing if packet is already buffered
 	return;		
+#endif
     if (!PollSocket(sock)) 	// do nothing if no packet to be read
 	return;
 
@@ -108,7 +132,7 @@ Network::Send(PacketHeader hdr, char* data)
 		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
     DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
 
-    interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
+    interrupt->Schedule(NetworkSendDone, (PtrInt)this, NetworkTime, NetworkSendInt);
 
     if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
 	DEBUG('n', "oops, lost it!\n");
@@ -55,7 +55,7 @@ class PacketHeader {
 class Network {
   public:
     Network(NetworkAddress addr, double reliability,
-  	  VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg);
+  	  VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, PtrInt callArg);
 				// Allocate and initialize network driver
     ~Network();			// De-allocate the network driver data
     
@@ -89,7 +89,7 @@ class Network {
 				//      can be sent.  
     VoidFunctionPtr readHandler;  // Interrupt handler, signalling packet has 
 				// 	arrived.
-    int handlerArg;		// Argument to be passed to interrupt handler
+    PtrInt handlerArg;		// Argument to be passed to interrupt handler
 				//   (pointer to post office)
     bool sendBusy;		// Packet is being sent.
     bool packetAvail;		// Packet has arrived, can be pulled off of
@@ -22,6 +22,9 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+#ifdef CHANGED
+    numMorphedWaits = 0;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -41,4 +44,9 @@ Statistics::Print()
     printf("Paging: faults %d\n", numPageFaults);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+#ifdef CHANGED
+    if (numMorphedWaits > 0)
+	printf("Wait morphing: %d wakeups into a held lock avoided\n",
+	    numMorphedWaits);
+#endif
 }
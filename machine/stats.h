@@ -35,6 +35,11 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+#ifdef CHANGED
+    int numMorphedWaits;	// threads signalled on a condition that were
+				// moved onto the lock's queue, rather than
+				// woken to find the lock still held
+#endif
 
     Statistics(); 		// initialize everything to zero
 
@@ -38,6 +38,12 @@ extern "C" {
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
+#ifdef CHANGED
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#endif
 #ifdef HOST_SPARC
 #include <sys/time.h>
 #endif
@@ -128,7 +134,7 @@ PollFile(int fd)
         pollTime.tv_usec = 0;                 	// no delay
 
 // poll file or socket
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
     retVal = select(32, (fd_set*)&rfd, (fd_set*)&wfd, (fd_set*)&xfd, &pollTime);
 #else
     retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
@@ -231,7 +237,7 @@ Lseek(int fd, int offset, int whence)
 int 
 Tell(int fd)
 {
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
     return lseek(fd,0,SEEK_CUR); // 386BSD doesn't have the tell() system call
 #else
     return tell(fd);
@@ -384,6 +390,170 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
 }
 
 
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Host input reactor
+// 	Rather than each device scheduling an interrupt every few ticks
+//	to poll its file or socket, a device registers the descriptor
+//	here and is called back once there is something to read.  The
+//	interrupt simulation checks for input now and then while
+//	threads are running (CheckInput(FALSE)), and when there is
+//	nothing else to do it blocks in the host until input arrives
+//	(CheckInput(TRUE)), instead of spinning.
+//
+//	Registrations are one-shot: after the callback, the descriptor
+//	is ignored until the device has read what arrived and calls
+//	RearmInput.
+//
+//	On Linux this uses epoll; elsewhere, select over the armed
+//	descriptors.
+//----------------------------------------------------------------------
+
+#define MaxInputFds 64
+
+static VoidFunctionPtr inputHandler[MaxInputFds];
+static PtrInt inputArg[MaxInputFds];
+static bool inputArmed[MaxInputFds];
+static int numArmed = 0;
+#ifdef __linux__
+static int epollFd = -1;
+#endif
+
+//----------------------------------------------------------------------
+// RegisterInput
+// 	Call "ready(arg)" when "fd" has input.  Returns FALSE for a
+//	descriptor the reactor can't wait on, such as a plain file
+//	(which is always readable); the device should poll that instead.
+//----------------------------------------------------------------------
+
+bool
+RegisterInput(int fd, VoidFunctionPtr ready, PtrInt arg)
+{
+    struct stat info;
+
+    ASSERT(fd >= 0 && fd < MaxInputFds && inputHandler[fd] == NULL);
+    if ((fstat(fd, &info) < 0) || S_ISREG(info.st_mode))
+	return FALSE;
+#ifdef __linux__
+    struct epoll_event event;
+
+    if (epollFd < 0) {
+	epollFd = epoll_create(MaxInputFds);
+	ASSERT(epollFd >= 0);
+    }
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+	return FALSE;
+#endif
+    inputHandler[fd] = ready;
+    inputArg[fd] = arg;
+    inputArmed[fd] = TRUE;
+    numArmed++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RearmInput
+// 	The device is ready for more input on "fd".
+//----------------------------------------------------------------------
+
+void
+RearmInput(int fd)
+{
+    ASSERT(inputHandler[fd] != NULL);
+    if (inputArmed[fd])
+	return;
+#ifdef __linux__
+    struct epoll_event event;
+
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+#endif
+    inputArmed[fd] = TRUE;
+    numArmed++;
+}
+
+//----------------------------------------------------------------------
+// UnregisterInput
+// 	Stop watching "fd", before it is closed.
+//----------------------------------------------------------------------
+
+void
+UnregisterInput(int fd)
+{
+    if (fd < 0 || fd >= MaxInputFds || inputHandler[fd] == NULL)
+	return;
+#ifdef __linux__
+    struct epoll_event event;		// ignored, but must not be NULL
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, &event);
+#endif
+    if (inputArmed[fd])
+	numArmed--;
+    inputHandler[fd] = NULL;
+    inputArmed[fd] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// WaitingForInput
+// 	Is any device waiting to be told about input?
+//----------------------------------------------------------------------
+
+bool
+WaitingForInput()
+{
+    return numArmed > 0;
+}
+
+//----------------------------------------------------------------------
+// CheckInput
+// 	Call the handler of every armed descriptor that has input.  If
+//	"block", wait in the host until at least one does.
+//----------------------------------------------------------------------
+
+void
+CheckInput(bool block)
+{
+    int fd;
+
+    if (numArmed == 0)
+	return;
+#ifdef __linux__
+    struct epoll_event events[MaxInputFds];
+    int count = epoll_wait(epollFd, events, MaxInputFds, block ? -1 : 0);
+
+    for (int i = 0; i < count; i++) {
+	fd = events[i].data.fd;
+	inputArmed[fd] = FALSE;
+	numArmed--;
+	(*inputHandler[fd])(inputArg[fd]);
+    }
+#else
+    fd_set readFds;
+    struct timeval pollTime;
+    int maxFd = -1;
+
+    FD_ZERO(&readFds);
+    for (fd = 0; fd < MaxInputFds; fd++)
+	if (inputArmed[fd]) {
+	    FD_SET(fd, &readFds);
+	    maxFd = fd;
+	}
+    pollTime.tv_sec = 0;
+    pollTime.tv_usec = 0;
+    if (select(maxFd + 1, &readFds, NULL, NULL, block ? NULL : &pollTime) <= 0)
+	return;
+    for (fd = 0; fd <= maxFd; fd++)
+	if (inputArmed[fd] && FD_ISSET(fd, &readFds)) {
+	    inputArmed[fd] = FALSE;
+	    numArmed--;
+	    (*inputHandler[fd])(inputArg[fd]);
+	}
+#endif
+}
+#endif
+
 //----------------------------------------------------------------------
 // CallOnUserAbort
 // 	Arrange that "func" will be called when the user aborts (e.g., by
@@ -393,7 +563,12 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
 void 
 CallOnUserAbort(VoidNoArgFunctionPtr func)
 {
+#ifdef CHANGED
+    (void)signal(SIGINT, (void (*)(int)) func);	// not a VoidFunctionPtr,
+						// whose argument is a PtrInt
+#else
     (void)signal(SIGINT, (VoidFunctionPtr) func);
+#endif
 }
 
 //----------------------------------------------------------------------
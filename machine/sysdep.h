@@ -17,6 +17,16 @@
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
+#ifdef CHANGED
+// Wait for input on files and sockets: devices register a descriptor
+// and are called back when it is readable (see sysdep.cc).
+extern bool RegisterInput(int fd, VoidFunctionPtr ready, PtrInt arg);
+extern void RearmInput(int fd);
+extern void UnregisterInput(int fd);
+extern bool WaitingForInput();
+extern void CheckInput(bool block);
+#endif
+
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
 extern int OpenForWrite(char *name);
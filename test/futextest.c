@@ -0,0 +1,27 @@
+/* futextest.c
+ *	The main thread waits for a forked worker with Wait/Wake instead
+ *	of spinning on Yield.  It only traps if the worker hasn't
+ *	finished yet.
+ */
+
+#include "syscall.h"
+
+int done = 0;
+
+void worker() {
+  Write("worker running\n", 15, ConsoleOutput);
+  done = 1;
+  Wake(&done, 1);
+  Exit(0);
+}
+
+int
+main()
+{
+  Fork(&worker);
+  while (done == 0)
+    Wait(&done, 0);
+  Write("main saw the worker finish\n", 27, ConsoleOutput);
+  Halt();
+  /* not reached */
+}
@@ -0,0 +1,119 @@
+/* malloc.c
+ *	A size-class allocator for user programs, built on Sbrk.
+ *
+ *	Small requests are rounded up to a power of two from 8 to 512
+ *	bytes.  Each class keeps its own free list, and when one runs dry
+ *	a whole arena is taken from Sbrk and carved into blocks of that
+ *	class, so most calls to malloc and free never trap to the kernel.
+ *	Larger requests get their own piece of the heap, which is kept on
+ *	a first-fit list when freed.
+ *
+ *	Every block is preceded by an 8 byte header giving its class and
+ *	usable size; on a free list, the block's first word links to the
+ *	next free block.
+ */
+
+#include "syscall.h"
+#include "malloc.h"
+
+#define NumClasses	7	/* 8, 16, ... 512 bytes */
+#define MinBlock	8
+#define MaxBlock	512
+#define ArenaSize	512	/* bytes taken from Sbrk per refill */
+#define Large		NumClasses	/* class of a block bigger than MaxBlock */
+
+typedef struct Header {
+  int sizeClass;
+  int size;		/* usable bytes after the header */
+} Header;
+
+static char *freeList[NumClasses + 1];	/* the last holds large blocks */
+
+#define HeaderOf(p)	((Header *) ((char *) (p) - sizeof(Header)))
+#define NextFree(p)	(*(char **) (p))
+
+static char *
+MoreCore(int bytes)
+{
+  char *p = Sbrk(bytes);
+
+  if (p == (char *) -1)
+    return 0;
+  return p;
+}
+
+/* Carve a fresh arena into blocks of class "c" and put them on its free
+ * list.  Returns 0 if the heap is full.
+ */
+static int
+Refill(int c)
+{
+  int block = (MinBlock << c) + sizeof(Header);
+  int count = ArenaSize / block;
+  char *arena;
+  int i;
+
+  if (count == 0)
+    count = 1;
+  arena = MoreCore(count * block);
+  if (arena == 0)
+    return 0;
+  for (i = 0; i < count; i++) {
+    char *p = arena + i * block + sizeof(Header);
+
+    HeaderOf(p)->sizeClass = c;
+    HeaderOf(p)->size = MinBlock << c;
+    NextFree(p) = freeList[c];
+    freeList[c] = p;
+  }
+  return 1;
+}
+
+void *
+malloc(int size)
+{
+  char *p, **prev;
+  int c;
+
+  if (size <= 0)
+    return 0;
+
+  if (size > MaxBlock) {
+    size = (size + MinBlock - 1) & ~(MinBlock - 1);
+    for (prev = &freeList[Large]; *prev != 0; prev = &NextFree(*prev)) {
+      if (HeaderOf(*prev)->size >= size) {
+	p = *prev;
+	*prev = NextFree(p);
+	return p;
+      }
+    }
+    p = MoreCore(size + sizeof(Header));
+    if (p == 0)
+      return 0;
+    p += sizeof(Header);
+    HeaderOf(p)->sizeClass = Large;
+    HeaderOf(p)->size = size;
+    return p;
+  }
+
+  for (c = 0; (MinBlock << c) < size; c++)
+    ;
+  if (freeList[c] == 0 && !Refill(c))
+    return 0;
+  p = freeList[c];
+  freeList[c] = NextFree(p);
+  return p;
+}
+
+void
+free(void *ptr)
+{
+  char *p = (char *) ptr;
+  int c;
+
+  if (p == 0)
+    return;
+  c = HeaderOf(p)->sizeClass;
+  NextFree(p) = freeList[c];
+  freeList[c] = p;
+}
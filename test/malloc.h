@@ -0,0 +1,17 @@
+/* malloc.h
+ *	Dynamic memory for user programs.  Link malloc.o after start.o
+ *	(see malloctest in the Makefile).
+ */
+
+#ifndef MALLOC_H
+#define MALLOC_H
+
+/* Return "size" bytes of fresh memory, 8 byte aligned, or 0 if the heap
+ * is exhausted.  Memory is not cleared on reuse.
+ */
+void *malloc(int size);
+
+/* Give back memory from malloc.  free(0) does nothing. */
+void free(void *ptr);
+
+#endif /* MALLOC_H */
@@ -0,0 +1,73 @@
+/* malloctest.c
+ *	Build a linked list on the heap, free it, and build it again; the
+ *	second time round every node comes off a free list, without
+ *	growing the heap.
+ */
+
+#include "syscall.h"
+#include "malloc.h"
+
+typedef struct Node {
+  struct Node *next;
+  int value;
+} Node;
+
+Node *
+build(int n)
+{
+  Node *head = 0, *node;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    node = (Node *) malloc(sizeof(Node));
+    if (node == 0)
+      return head;
+    node->value = i;
+    node->next = head;
+    head = node;
+  }
+  return head;
+}
+
+int
+sum(Node *head)
+{
+  int total = 0;
+
+  for (; head != 0; head = head->next)
+    total += head->value;
+  return total;
+}
+
+void
+release(Node *head)
+{
+  Node *next;
+
+  for (; head != 0; head = next) {
+    next = head->next;
+    free(head);
+  }
+}
+
+int
+main()
+{
+  Node *list;
+  char *top;
+
+  list = build(40);
+  if (sum(list) != 780)
+    Write("wrong sum\n", 10, ConsoleOutput);
+  release(list);
+
+  top = Sbrk(0);
+  list = build(40);
+  if (Sbrk(0) != top)
+    Write("heap grew\n", 10, ConsoleOutput);
+  if (sum(list) == 780)
+    Write("malloc ok\n", 10, ConsoleOutput);
+  release(list);
+  Halt();
+  /* not reached */
+}
@@ -0,0 +1,34 @@
+/* pipetest.c
+ *	Stream a message through a pipe from a forked writer thread
+ *	to the main thread, which echoes it to the console.
+ */
+
+#include "syscall.h"
+
+OpenFileId fids[2];
+
+void writer() {
+  Write("Hello through a pipe\n", 21, fids[1]);
+  Close(fids[1]);
+  Exit(0);
+}
+
+int
+main()
+{
+  char buffer[8];
+  int n;
+
+  if (Pipe(fids) < 0) {
+    Write("Pipe failed\n", 12, ConsoleOutput);
+    Halt();
+  }
+  Fork(&writer);
+
+  /* read until the writer closes its end */
+  while ((n = Read(buffer, 8, fids[0])) > 0)
+    Write(buffer, n, ConsoleOutput);
+  Close(fids[0]);
+  Halt();
+  /* not reached */
+}
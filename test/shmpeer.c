@@ -0,0 +1,23 @@
+/* shmpeer.c
+ *	The other half of shmtest: write a message into the "message"
+ *	segment, wherever it lands in this address space.  It exits
+ *	still attached, leaving the kernel to detach it.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+  char *text = "Hello through shared memory\n";
+  char *message;
+  int i;
+
+  message = SegmentAttach(SegmentCreate("message", 64), 0);
+  if (message == 0)
+    Exit(-1);
+  for (i = 0; text[i] != '\0'; i++)
+    message[i] = text[i];
+  message[i] = '\0';
+  Exit(0);
+}
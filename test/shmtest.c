@@ -0,0 +1,31 @@
+/* shmtest.c
+ *	Attach a shared segment, Exec "shmpeer" to fill it in from its
+ *	own address space, then print what it left there.  Neither
+ *	detaches: the segment must outlive shmpeer's exit, and be freed
+ *	(once) when shmtest exits.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+  SegmentId id;
+  char *message;
+  int n;
+
+  id = SegmentCreate("message", 64);
+  message = SegmentAttach(id, 0);
+  if (message == 0) {
+    Write("SegmentAttach failed\n", 21, ConsoleOutput);
+    Halt();
+  }
+  message[0] = '\0';
+
+  Join(Exec("shmpeer"));
+
+  for (n = 0; message[n] != '\0'; n++)
+    ;
+  Write(message, n, ConsoleOutput);
+  Exit(0);
+}
@@ -130,6 +130,78 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl Pipe
+	.ent	Pipe
+Pipe:
+	addiu $2,$0,SC_Pipe
+	syscall
+	j	$31
+	.end Pipe
+
+	.globl SegmentCreate
+	.ent	SegmentCreate
+SegmentCreate:
+	addiu $2,$0,SC_SegmentCreate
+	syscall
+	j	$31
+	.end SegmentCreate
+
+	.globl SegmentAttach
+	.ent	SegmentAttach
+SegmentAttach:
+	addiu $2,$0,SC_SegmentAttach
+	syscall
+	j	$31
+	.end SegmentAttach
+
+	.globl SegmentDetach
+	.ent	SegmentDetach
+SegmentDetach:
+	addiu $2,$0,SC_SegmentDetach
+	syscall
+	j	$31
+	.end SegmentDetach
+
+	.globl Wait
+	.ent	Wait
+Wait:
+	addiu $2,$0,SC_Wait
+	syscall
+	j	$31
+	.end Wait
+
+	.globl Wake
+	.ent	Wake
+Wake:
+	addiu $2,$0,SC_Wake
+	syscall
+	j	$31
+	.end Wake
+
+	.globl Sbrk
+	.ent	Sbrk
+Sbrk:
+	addiu $2,$0,SC_Sbrk
+	syscall
+	j	$31
+	.end Sbrk
+
+	.globl SetTickets
+	.ent	SetTickets
+SetTickets:
+	addiu $2,$0,SC_SetTickets
+	syscall
+	j	$31
+	.end SetTickets
+
+	.globl GetUsage
+	.ent	GetUsage
+GetUsage:
+	addiu $2,$0,SC_GetUsage
+	syscall
+	j	$31
+	.end GetUsage
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
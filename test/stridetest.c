@@ -0,0 +1,31 @@
+/* stridetest.c
+ *	Two threads compete for the CPU with 1:3 tickets.  Run with
+ *	"nachos -sched stride -sr -x stridetest"; the report at halt
+ *	compares each thread's share of the CPU with its tickets.
+ */
+
+#include "syscall.h"
+
+int stop = 0;
+
+void worker() {
+  SetTickets(300);
+  while (stop == 0)
+    ;
+  Exit(0);
+}
+
+int
+main()
+{
+  int i;
+
+  SetTickets(100);
+  Fork(&worker);
+  for (i = 0; i < 20000; i++)
+    ;
+  stop = 1;
+  Write("main done spinning\n", 19, ConsoleOutput);
+  Halt();
+  /* not reached */
+}
@@ -0,0 +1,40 @@
+/* usagetest.c
+ *	A forked worker spins and exits while the main thread blocks in
+ *	Wait for it.  The process's usage must then cover both threads,
+ *	and the main thread must have been blocked.  Run with "-sr" for
+ *	the per-thread and per-process report at halt.
+ */
+
+#include "syscall.h"
+
+int done = 0;
+
+void worker() {
+  int i;
+
+  for (i = 0; i < 5000; i++)
+    ;
+  done = 1;
+  Wake(&done, 1);
+  Exit(0);
+}
+
+int
+main()
+{
+  Usage mine, all;
+
+  Fork(&worker);
+  while (done == 0)
+    Wait(&done, 0);
+  Yield();				/* let the worker finish exiting */
+  GetUsage(&mine, UsageThread);
+  GetUsage(&all, UsageProcess);
+  if (mine.userTicks > 0 && all.userTicks > mine.userTicks
+      && mine.blockedTicks > 0 && all.switches >= mine.switches)
+    Write("usage adds up\n", 14, ConsoleOutput);
+  else
+    Write("usage is wrong\n", 15, ConsoleOutput);
+  Halt();
+  /* not reached */
+}
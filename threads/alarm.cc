@@ -0,0 +1,117 @@
+// alarm.cc
+//	Routines to let kernel threads sleep for a while, without using
+//	the CPU.
+//
+//	Sleeping threads are kept on a queue sorted by when they are to
+//	wake up, and a single one-shot interrupt is scheduled for the
+//	first of them.  When it fires, every thread that is due is made
+//	ready, and the interrupt is rescheduled for the next.  A thread
+//	that goes to sleep ahead of the rest cancels the interrupt and
+//	schedules an earlier one.
+//
+//	So nothing runs on behalf of a sleeping thread until it is time
+//	to wake it, and if nothing else is ready, Interrupt::Idle skips
+//	the clock straight to the wakeup.  The alarm interrupt is not a
+//	TimerInt, so Idle doesn't take it for the time-slice timer and
+//	halt while there are threads asleep.
+//
+//	Like the scheduler, this relies on interrupts being disabled for
+//	mutual exclusion.
+
+#include "copyright.h"
+#include "alarm.h"
+#include "system.h"
+
+// dummy function because C++ does not allow pointers to member functions
+static void AlarmHandler(PtrInt arg)
+{ Alarm *p = (Alarm *)arg; p->WakeUp(); }
+
+//----------------------------------------------------------------------
+// Alarm::Alarm
+// 	Initialize the alarm, with no threads asleep.
+//----------------------------------------------------------------------
+
+Alarm::Alarm()
+{
+    sleepers = new Queue;
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+// 	De-allocate the alarm.  Any threads still asleep are left that way.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+    interrupt->Cancel(nextWakeup);
+    delete sleepers;
+}
+
+//----------------------------------------------------------------------
+// Alarm::SleepUntil
+// 	Put the current thread to sleep until the simulated time reaches
+//	"when".  Returns straight away if it already has.
+//----------------------------------------------------------------------
+
+void
+Alarm::SleepUntil(int when)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (when > stats->totalTicks) {
+	DEBUG('t', "Thread \"%s\" sleeping until %d\n",
+	      currentThread->getName(), when);
+	sleepers->SortedInsert(&currentThread->queueLink, when);
+	if (sleepers->Head() == &currentThread->queueLink)
+	    Arm();			// we're first to wake
+	currentThread->Sleep();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::SleepFor
+// 	Put the current thread to sleep for "ticks" of simulated time.
+//----------------------------------------------------------------------
+
+void
+Alarm::SleepFor(int ticks)
+{
+    SleepUntil(stats->totalTicks + ticks);
+}
+
+//----------------------------------------------------------------------
+// Alarm::WakeUp
+// 	The alarm interrupt: make ready every thread whose wakeup time
+//	has come, and schedule the interrupt for the next one.
+//----------------------------------------------------------------------
+
+void
+Alarm::WakeUp()
+{
+    int when;
+
+    while (!sleepers->IsEmpty() && sleepers->Head()->key <= stats->totalTicks) {
+	Thread *thread = (Thread *)sleepers->SortedRemove(&when);
+	DEBUG('t', "Waking thread \"%s\", due at %d\n", thread->getName(),
+	      when);
+	scheduler->ReadyToRun(thread);
+    }
+    Arm();
+}
+
+//----------------------------------------------------------------------
+// Alarm::Arm
+// 	Schedule the alarm interrupt for the first sleeper, in place of
+//	whatever was scheduled before.
+//----------------------------------------------------------------------
+
+void
+Alarm::Arm()
+{
+    interrupt->Cancel(nextWakeup);	// harmless if it has fired
+    if (!sleepers->IsEmpty())
+	nextWakeup = interrupt->Schedule(AlarmHandler, (PtrInt)this,
+			max(sleepers->Head()->key - stats->totalTicks, 1),
+			AlarmInt);
+}
@@ -0,0 +1,34 @@
+// alarm.h
+//	Data structures for putting kernel threads to sleep until a
+//	given simulated time.
+//
+//	See alarm.cc for the details.
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include "copyright.h"
+#include "queue.h"
+#include "interrupt.h"
+
+class Alarm {
+  public:
+    Alarm();				// no one asleep to start with
+    ~Alarm();
+
+    void SleepUntil(int when);		// block the current thread until
+					// stats->totalTicks reaches "when"
+    void SleepFor(int ticks);		// the same, "ticks" from now
+
+    void WakeUp();			// called from the alarm interrupt:
+					// make ready everyone who is due
+    bool IsEmpty() { return sleepers->IsEmpty(); }
+
+  private:
+    Queue *sleepers;			// sleeping threads, by wakeup time
+    InterruptHandle nextWakeup;		// the interrupt for the first of
+					// them, if any
+    void Arm();				// schedule that interrupt
+};
+
+#endif // ALARM_H
@@ -9,54 +9,112 @@
 // synchronisation primitives ensure that there are no
 // collisions on the bridge, or that not too many vehicles
 // are on the bridge at the same time.
+//
+// Traffic goes one way at a time, in phases.  A phase lets on up to
+// "batch" cars while cars are waiting to go the other way, then hands
+// the bridge over once it is clear; with no one waiting the other way
+// it carries on.  A small batch is fairer, as neither side waits long;
+// a large one has fewer changes of direction, each of which leaves the
+// bridge to empty out first.  A batch of 0 never hands over while cars
+// keep coming the current way.
+//
+// Each direction has its own condition variable, so a car leaving
+// wakes only a car that can take its place: one going the same way,
+// or, when the phase ends, a bridgeful going the other way.
 #ifdef CHANGED
 #include "system.h"
 #include "bridge.h"
 #include "synch.h"
 
-Bridge::Bridge(int max)
+Bridge::Bridge(int max, int batchSize)
 {
-  full = new Condition("Bridge full");
+  queue[0] = new Condition("Bridge direction 0");
+  queue[1] = new Condition("Bridge direction 1");
   mutex = new Lock("Bridge");
 
   currDirection = 0;
   maxCars = max;
   totalCars = 0;
   inCS = 0;
+
+  batch = batchSize;
+  admitted = phases = 0;
+  for (int d = 0; d < 2; d++) {
+    waiting[d] = crossed[d] = waitTicks[d] = maxWait[d] = 0;
+    for (int i = 0; i < BridgeBuckets; i++)
+      histogram[d][i] = 0;
+  }
 }
 
 
 Bridge::~Bridge()
 {
-  delete full;
+  delete queue[0];
+  delete queue[1];
   delete mutex;
 }
 
 
+// Can a car going in "direction" get on the bridge now?
+//
+// Going the current way, if there's room and the phase isn't over.
+// Going the other way, only once the bridge is clear, and the phase
+// is over or no one else wants to go the current way.
+bool Bridge::CanEnter(int direction)
+{
+  bool othersWaiting = (waiting[1 - direction] > 0);
+
+  if (totalCars == maxCars)
+    return FALSE;
+  if (direction == currDirection)
+    return !(PhaseOver() && othersWaiting);
+  return (totalCars == 0) && (PhaseOver() || waiting[currDirection] == 0);
+}
+
+
 // Car arrives at the bridge.
 //
 // Invariants for the critical section:
 // - There are no cars on the bridge
 // - OR there are less than "maxCars" on the bridge, and they 
 //   are travelling in the same direction as the passed value.
+//
+// How long the car waits goes in the histogram for its direction.
 void Bridge::ArriveBridge(int direction)
 {
   mutex->Acquire();
   printf("%s arriving at bridge (direction: %d)\n", currentThread->getName(), direction);
+  int arrived = stats->totalTicks;
 
-  while ((totalCars > 0) && ((totalCars == maxCars) || (currDirection != direction)))
+  while (!CanEnter(direction))
   {
     printf("- %s waiting to enter bridge (direction: %d) - ", currentThread->getName(), direction);
     printf("%d cars on bridge in dir %d\n", totalCars, currDirection);
-    full->Wait(mutex);
+    waiting[direction]++;
+    queue[direction]->Wait(mutex);
+    waiting[direction]--;
   }
   printf("%s entering bridge (direction: %d)\n", currentThread->getName(), direction);
 
   DEBUG('t', "Thread \"%s\" is ENTERING critical section \n", currentThread->getName());
   ASSERT(inCS == 0);
   inCS++;
+  ASSERT(totalCars == 0 || direction == currDirection);
+  if (direction != currDirection) {	// a new phase
+    currDirection = direction;
+    admitted = 0;
+    phases++;
+  }
+  admitted++;
   totalCars++;
-  currDirection = direction;
+
+  int wait = stats->totalTicks - arrived, bucket = 0;
+  while (bucket < BridgeBuckets - 1 && wait >= (1 << bucket))
+    bucket++;			// bucket b >= 1 is [2^(b-1), 2^b)
+  histogram[direction][bucket]++;
+  crossed[direction]++;
+  waitTicks[direction] += wait;
+  maxWait[direction] = max(maxWait[direction], wait);
   inCS--;
   ASSERT(inCS == 0);
   DEBUG('t', "Thread \"%s\" is EXITING critical section.\n",  currentThread->getName());
@@ -75,7 +133,9 @@ void Bridge::CrossBridge(int direction)
 // Thread wants to exit the bridge.
 //
 // Simply needs to acquire the lock in order to exit the bridge.
-// Also signals any threads blocked on a full bridge.
+// If the phase is over, or no one else is waiting to go this way, the
+// last car off lets on a bridgeful going the other way; otherwise
+// each car off lets one more on going this way.
 void Bridge::ExitBridge(int direction)
 {
   mutex->Acquire();
@@ -89,7 +149,39 @@ void Bridge::ExitBridge(int direction)
   ASSERT(inCS == 0);
   DEBUG('t', "Thread \"%s\" is EXITING critical section.\n",  currentThread->getName());
 
-  full->Signal(mutex);
+  int other = 1 - currDirection;
+  if (waiting[other] > 0 && (PhaseOver() || waiting[currDirection] == 0)) {
+    if (totalCars == 0)
+      for (int i = 0; i < min(waiting[other], maxCars); i++)
+	queue[other]->Signal(mutex);
+  } else if (waiting[currDirection] > 0)
+    queue[currDirection]->Signal(mutex);
+  mutex->Release();
+}
+
+
+// Print how many times the traffic changed direction, and for each
+// direction how long cars waited to get on the bridge.
+void Bridge::Print()
+{
+  mutex->Acquire();
+  printf("Bridge: %d cars at most, %d per phase while the other side "
+	 "waits, %d phases\n", maxCars, batch, phases);
+  for (int d = 0; d < 2; d++) {
+    printf("Direction %d: %d cars, wait %.1f ticks on average, %d at most\n",
+	   d, crossed[d], (double)waitTicks[d] / max(crossed[d], 1), maxWait[d]);
+    for (int b = 0; b < BridgeBuckets; b++) {
+      if (histogram[d][b] == 0)
+	continue;
+      if (b == 0)
+	printf("  %13s", "no wait");
+      else if (b == BridgeBuckets - 1)
+	printf("  %6d and up", 1 << (b - 1));
+      else
+	printf("  %6d-%-6d", 1 << (b - 1), (1 << b) - 1);
+      printf(" %6d\n", histogram[d][b]);
+    }
+  }
   mutex->Release();
 }
 
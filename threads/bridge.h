@@ -5,18 +5,47 @@
 #include "list.h"
 #include "synch.h"
 
+#ifdef CHANGED
+#define BridgeBuckets	16	// wait histogram: no wait, then powers
+				// of two of ticks, the last open-ended
+#endif
+
 class Bridge {
  public:
+#ifdef CHANGED
+  Bridge(int max, int batch);	// at most "max" cars on the bridge, and
+				// "batch" in a row one way while cars
+				// wait the other way (0 for no limit)
+#else
   Bridge(int max);
+#endif
   ~Bridge();
 
   void ArriveBridge(int direction);
   void CrossBridge(int direction);
   void ExitBridge(int direction);
+#ifdef CHANGED
+  void Print();			// phases and wait histograms
+#endif
 
  private:
   Lock *mutex;
+#ifdef CHANGED
+  bool CanEnter(int direction);
+  bool PhaseOver() { return (batch > 0) && (admitted >= batch); }
+
+  Condition *queue[2];	// cars waiting to go each way
+  int waiting[2];	// ... and how many
+  int batch;		// cars per phase, if the other side is waiting
+  int admitted;		// cars let on this phase
+  int phases;		// times the direction changed
+  int crossed[2];
+  int waitTicks[2];	// total and longest wait to get on
+  int maxWait[2];
+  int histogram[2][BridgeBuckets];
+#else
   Condition *full;
+#endif
   int currDirection;
   int totalCars;
   int maxCars;
@@ -9,11 +9,14 @@
 
 
 Bridge *bridge;
+#ifdef CHANGED
+static int carsLeft;		// the last car home prints the statistics
+#endif
 
 
 // The car attempts to cross the bridge in repeatedly
 // opposing directions.
-void Car(int which)
+void Car(PtrInt which)
 {
   int direction;
   for (int i = 0; i < 60; i++)
@@ -25,9 +28,13 @@ void Car(int which)
     bridge->CrossBridge(direction);
     currentThread->Yield();
     bridge->ExitBridge(direction);
-    printf("Car %d has crossed the bridge in direction %d\n\n", which, direction);
+    printf("Car %d has crossed the bridge in direction %d\n\n", (int) which, direction);
     currentThread->Yield();
   }
+#ifdef CHANGED
+  if (--carsLeft == 0)
+    bridge->Print();
+#endif
 }
 
 
@@ -36,16 +43,23 @@ void Car(int which)
 // Each car runs in a separate thread.
 void BridgeTest()
 {
+#ifdef CHANGED
+  bridge = new Bridge(3, 6);	// two bridgefuls a phase
+#else
   bridge = new Bridge(3);
+#endif
   int maxCars = 20;
   char* name;
   Thread *cars[maxCars];
+#ifdef CHANGED
+  carsLeft = maxCars;
+#endif
 
   for (int i = 0; i < maxCars; i++)
   {
     name = (char *)malloc(sizeof(char) * 8);
     sprintf(name, "Car %d", i);
-    cars[i] = new Thread(name);
+    cars[i] = threadPool->Get(name);
     cars[i]->Fork(Car, i);
   }  
 }
@@ -0,0 +1,302 @@
+// cpu.cc
+//	Routines to simulate a multiprocessor.
+//
+//	Each CPU is driven by a host thread of its own, and has its own
+//	running thread, and its own clock, which advances as the thread
+//	on it runs.  The simulation runs whichever busy CPU is furthest
+//	behind, switching to it (in Interrupt::OneTick) once the CPU it
+//	is on has got more than CpuSkew ticks ahead -- so threads on
+//	different CPUs really do run at the same time, interleaved at
+//	a few instructions apart.  stats->totalTicks is the clock of the
+//	CPU furthest behind, which is how far the whole machine has got;
+//	it is that time that device interrupts go off at.
+//
+//	Switching CPUs hands the simulation from one CPU's host thread to
+//	the other's (Cpu::HandOff), not through the scheduler: both
+//	threads stay RUNNING, each on its own CPU.  A thread runs on the
+//	host thread of whichever CPU it is on, so one that moves CPU moves
+//	host thread too, stack and all.
+//
+//	The host threads take turns, under one lock: only the CPU being
+//	simulated runs.  CPUs are only ever switched with interrupts off,
+//	at the same points a uniprocessor would take an interrupt, so the
+//	kernel's critical sections, which disable interrupts, are atomic
+//	across all the CPUs, and a run is as repeatable as on one CPU.
+//	The price is that more host cores don't make the simulation any
+//	faster; letting the CPUs run at once would first need real locks
+//	throughout the kernel, in place of disabling interrupts.
+//
+//	A CPU with nothing to run goes to its idle thread.  That doesn't
+//	hold back the clock, and it isn't simulated again until another
+//	CPU makes a thread ready and sends it an inter-processor
+//	interrupt (Interrupt::SendIPI).  When every CPU is idle, the
+//	machine is idle, and time skips ahead to the next interrupt, as
+//	on a uniprocessor.
+//
+//	Under FIFO scheduling each CPU has a run queue of its own, so that
+//	CPUs aren't all contending for one.  A thread made ready goes on
+//	the queue of the CPU that made it ready, and a CPU that runs out
+//	steals from the back of another's (see Scheduler::FindNextToRun).
+//
+//	Stride, MLFQ and real-time scheduling account for CPU time as if
+//	there were one running thread, so only FIFO and priority
+//	scheduling can be used with more than one CPU.
+
+#include "copyright.h"
+#include "cpu.h"
+#include "system.h"
+
+// Whichever host thread is simulating a CPU holds this; the others wait
+// for their CPU's turn.
+static pthread_mutex_t simulationLock = PTHREAD_MUTEX_INITIALIZER;
+
+// dummy functions because C++ does not allow pointers to member functions
+static void CpuIdle(PtrInt arg)
+{ Cpu *p = (Cpu *)arg; p->IdleLoop(); }
+
+static void *CpuHost(void *arg)
+{ Cpu *p = (Cpu *)arg; p->RunHost(); return NULL; }
+
+//----------------------------------------------------------------------
+// Cpu::Cpu
+// 	Initialize a CPU.  CPU 0 is running the main thread, on the main
+//	host thread, which starts out with the simulation lock; the others
+//	start out idle, each with a host thread of its own waiting for the
+//	lock.
+//
+//	"which" is the CPU's number.
+//----------------------------------------------------------------------
+
+Cpu::Cpu(int which)
+{
+    id = which;
+    current = NULL;
+    idleThread = NULL;
+    if (numCpus > 1) {
+	sprintf(name, "idle %d", id);
+	idleThread = new Thread(name);
+	idleThread->StackAllocate(CpuIdle, (PtrInt)this);
+	if (id > 0)
+	    current = idleThread;
+    }
+    idle = (id > 0);
+    clock = 0;
+    status = SystemMode;
+    yieldOnReturn = FALSE;
+    busyTicks = switchedTo = ipis = 0;
+
+    queueCapacity = RunQueueSize;
+    runQueue = new Thread*[queueCapacity];
+    queueHead = queueCount = 0;
+    enqueued = lengthSum = maxLength = 0;
+    steals = stolen = 0;
+
+    if (numCpus > 1) {
+	pthread_cond_init(&turn, NULL);
+	if (id == 0)
+	    pthread_mutex_lock(&simulationLock);
+	else {
+	    int error = pthread_create(&host, NULL, CpuHost, this);
+	    ASSERT(error == 0);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Cpu::RunHost
+// 	The host thread of a CPU other than CPU 0.  Wait for the CPU's
+//	first turn, then switch to its idle thread, leaving this host
+//	thread's own stack for good.  From then on the host thread runs
+//	whichever thread is on the CPU.
+//----------------------------------------------------------------------
+
+void
+Cpu::RunHost()
+{
+    Thread *boot = new Thread(name);	// somewhere for SWITCH to save
+					// the host thread's own context
+    pthread_mutex_lock(&simulationLock);
+    WaitTurn();
+    SWITCH(boot, current);
+    ASSERT(FALSE);			// never switched back to
+}
+
+//----------------------------------------------------------------------
+// Cpu::HandOff
+// 	Give the simulation to CPU "to", which must already be currentCpu,
+//	by waking its host thread; then wait until some CPU hands it back
+//	to us.
+//----------------------------------------------------------------------
+
+void
+Cpu::HandOff(Cpu *to)
+{
+    ASSERT(currentCpu == to);
+    pthread_cond_signal(&to->turn);
+    WaitTurn();
+}
+
+//----------------------------------------------------------------------
+// Cpu::WaitTurn
+// 	Wait, with the simulation lock released, until this CPU is the one
+//	being simulated.
+//----------------------------------------------------------------------
+
+void
+Cpu::WaitTurn()
+{
+    while (currentCpu != this)
+	pthread_cond_wait(&turn, &simulationLock);
+}
+
+//----------------------------------------------------------------------
+// Cpu::IdleLoop
+// 	Run whatever is ready; when nothing is, let the other CPUs run,
+//	or if they're all idle too, wait for an interrupt.  Interrupts
+//	stay off, so the idle thread only comes off the CPU by running
+//	another thread, or by the simulation switching CPUs here.
+//----------------------------------------------------------------------
+
+void
+Cpu::IdleLoop()
+{
+    Thread *nextThread;
+    Cpu *other;
+
+    (void) interrupt->SetLevel(IntOff);
+    for (;;) {
+	ASSERT(currentCpu == this);
+	if ((nextThread = scheduler->FindNextToRun()) != NULL) {
+	    if (idle)
+		Wake();
+	    scheduler->Run(nextThread);	// back when it blocks, and
+	    continue;			// nothing else is ready
+	}
+	idle = TRUE;
+	if ((other = EarliestCpu()) != NULL)
+	    interrupt->SwitchCpu(other);	// back when we're sent an IPI
+	else
+	    interrupt->Idle();		// the whole machine is idle
+    }
+}
+
+//----------------------------------------------------------------------
+// Cpu::Wake
+// 	Bring an idle CPU back into the simulation.  Its clock has been
+//	stopped; it picks up from the machine's.
+//----------------------------------------------------------------------
+
+void
+Cpu::Wake()
+{
+    idle = FALSE;
+    clock = max(clock, stats->totalTicks);
+}
+
+//----------------------------------------------------------------------
+// Cpu::Print
+// 	Print the CPU's statistics, at halt.
+//----------------------------------------------------------------------
+
+void
+Cpu::Print()
+{
+    printf("CPU %d: busy %d ticks, switched to %d times, %d IPIs\n",
+	   id, busyTicks, switchedTo, ipis);
+    if (enqueued > 0 || steals > 0)
+	printf("       run queue: %d threads, average length %.2f, max %d; "
+	       "stole %d, lost %d\n", enqueued,
+	       (double)lengthSum / max(enqueued, 1), maxLength, steals, stolen);
+}
+
+//----------------------------------------------------------------------
+// Cpu::Enqueue
+// 	Put a thread on the back of the run queue, growing it if need be.
+//----------------------------------------------------------------------
+
+void
+Cpu::Enqueue(Thread *thread)
+{
+    if (queueCount == queueCapacity) {
+	Thread **bigger = new Thread*[2 * queueCapacity];
+	for (int i = 0; i < queueCount; i++)
+	    bigger[i] = runQueue[(queueHead + i) % queueCapacity];
+	delete [] runQueue;
+	runQueue = bigger;
+	queueHead = 0;
+	queueCapacity *= 2;
+    }
+    runQueue[(queueHead + queueCount) % queueCapacity] = thread;
+    queueCount++;
+    enqueued++;
+    lengthSum += queueCount;
+    maxLength = max(maxLength, queueCount);
+}
+
+//----------------------------------------------------------------------
+// Cpu::Dequeue
+// 	Take the thread off the front of the run queue, for this CPU to
+//	run.  NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+Thread *
+Cpu::Dequeue()
+{
+    Thread *thread;
+
+    if (queueCount == 0)
+	return NULL;
+    thread = runQueue[queueHead];
+    queueHead = (queueHead + 1) % queueCapacity;
+    queueCount--;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Cpu::Steal
+// 	Take the thread off the back of the run queue -- the one made
+//	ready last, which would have been the last to run here -- for
+//	another CPU.  NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+Thread *
+Cpu::Steal()
+{
+    if (queueCount == 0)
+	return NULL;
+    queueCount--;
+    return runQueue[(queueHead + queueCount) % queueCapacity];
+}
+
+//----------------------------------------------------------------------
+// EarliestCpu
+// 	Return the busy CPU whose clock is furthest behind -- the one to
+//	simulate next -- or NULL if every CPU is idle.
+//----------------------------------------------------------------------
+
+Cpu *
+EarliestCpu()
+{
+    Cpu *earliest = NULL;
+
+    for (int i = 0; i < numCpus; i++)
+	if (!cpus[i]->idle && (earliest == NULL
+			       || cpus[i]->clock < earliest->clock))
+	    earliest = cpus[i];
+    return earliest;
+}
+
+//----------------------------------------------------------------------
+// IdleCpu
+// 	Return an idle CPU, other than the one we're on, to give a
+//	thread that has just been made ready to.  NULL if there isn't one.
+//----------------------------------------------------------------------
+
+Cpu *
+IdleCpu()
+{
+    for (int i = 0; i < numCpus; i++)
+	if (cpus[i]->idle && cpus[i] != currentCpu)
+	    return cpus[i];
+    return NULL;
+}
@@ -0,0 +1,92 @@
+// cpu.h
+//	Data structures for simulating a multiprocessor.
+//
+//	With "nachos -cpus N", the simulated machine has N CPUs, each
+//	with its own running thread, register state and interrupt state.
+//	See cpu.cc for how they are simulated.
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "copyright.h"
+#include "thread.h"
+#include "interrupt.h"
+
+#include <pthread.h>
+
+#define MaxCpus		16
+
+// How far (in ticks) one CPU may run ahead of the others before the
+// simulation switches to the one that is furthest behind.  Smaller
+// interleaves the CPUs more finely, and costs more host time.
+#define CpuSkew		SystemTick
+
+// Each CPU has its own run queue, under FIFO scheduling, which starts
+// out this long and grows as need be.
+#define RunQueueSize	16
+
+// The following class defines a simulated CPU.  The internal data
+// structures are left public, as with PendingInterrupt: the interrupt
+// simulation and the scheduler both keep them up to date.
+
+class Cpu {
+  public:
+    Cpu(int which);			// a CPU, with an idle thread of its
+					// own if there is more than one
+    void IdleLoop();			// what the idle thread runs
+    void RunHost();			// what the CPU's host thread runs
+    void Wake();			// start simulating an idle CPU again
+    void HandOff(Cpu *to);		// let "to"'s host thread simulate,
+					// until it's this CPU's turn again
+    void Print();			// busy time, switches, IPIs, and
+					// run queue statistics
+
+    // The CPU's run queue: a deque of threads made ready here.  The
+    // CPU takes them off the front; an idle CPU with nothing of its own
+    // steals them off the back.
+    void Enqueue(Thread *thread);	// put a thread on the back
+    Thread *Dequeue();			// take one off the front, or NULL
+    Thread *Steal();			// take one off the back, or NULL
+    int QueueLength() { return queueCount; }
+
+    int id;
+    Thread *current;			// the thread running here; only up to
+					// date while another CPU is simulated
+					// (currentThread is, for this one)
+    Thread *idleThread;			// runs when there's nothing else to
+    bool idle;				// in the idle loop, with nothing to
+					// run: doesn't hold back the clock
+    int clock;				// this CPU's own simulated time
+
+    // this CPU's interrupt state, while another CPU is simulated
+    MachineStatus status;
+    bool yieldOnReturn;
+
+    int busyTicks;			// ticks spent running threads
+    int switchedTo;			// times the simulation switched here
+    int ipis;				// inter-processor interrupts received
+
+    int enqueued;			// threads put on our run queue
+    int lengthSum;			// the sum of its lengths, as each
+					// was put on, for the average
+    int maxLength;
+    int steals;				// threads we took from other CPUs
+    int stolen;				// threads they took from us
+
+  private:
+    char name[16];			// for the idle thread
+
+    pthread_t host;			// the host thread simulating us
+    pthread_cond_t turn;		// signalled when we become currentCpu
+    void WaitTurn();			// until this CPU is currentCpu
+
+    Thread **runQueue;			// circular buffer
+    int queueHead;			// index of the front
+    int queueCount;
+    int queueCapacity;
+};
+
+extern Cpu *EarliestCpu();		// busy CPU with the least clock
+extern Cpu *IdleCpu();			// an idle CPU, other than this one
+
+#endif // CPU_H
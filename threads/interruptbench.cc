@@ -0,0 +1,117 @@
+// interruptbench.cc
+//	Microbenchmark for the pending interrupt queue.
+//
+//	Keeps "numPending" simulated device interrupts outstanding and,
+//	"numFires" times, takes the next one off the queue and puts it
+//	back a random time later, as a device rescheduling itself from
+//	its handler would.  This is timed on the pending heap and on a
+//	sorted List -- the way pending interrupts used to be kept -- with
+//	the same driver, so the two figures compare the data structures
+//	alone.  Finally it times scheduling an interrupt and cancelling it
+//	again, through the real Interrupt interface.
+//
+//	Run with "nachos -ib <pending> <fires>".
+
+#ifdef CHANGED
+#include <time.h>
+#include "system.h"
+
+#define BenchSpread	1000		// interrupts are 1..BenchSpread
+					// ticks apart
+
+//----------------------------------------------------------------------
+// BenchDevice
+// 	Interrupt handler for a pretend device.  The interrupts timed
+//	here never fire.
+//----------------------------------------------------------------------
+
+static void
+BenchDevice(PtrInt which)
+{
+}
+
+//----------------------------------------------------------------------
+// NanosPer
+// 	Host time since "start", per operation.
+//----------------------------------------------------------------------
+
+static double
+NanosPer(clock_t start, int ops)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ops;
+}
+
+//----------------------------------------------------------------------
+// InterruptBenchmark
+// 	main.cc calls this function.  The heap is timed on an Interrupt
+//	of its own, so that nothing the kernel has scheduled gets in the
+//	way; we are a friend of Interrupt, to get at it.
+//----------------------------------------------------------------------
+
+void
+InterruptBenchmark(int numPending, int numFires)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    PendingInterrupt **events;
+    PendingInterrupt *next;
+    clock_t start;
+    int i, when;
+
+    ASSERT(numPending > 0 && numFires > 0);
+    printf("Interrupt benchmark: %d pending, %d fired\n", numPending,
+		numFires);
+    events = new PendingInterrupt*[numPending];
+    for (i = 0; i < numPending; i++)
+	events[i] = new PendingInterrupt(BenchDevice, i, 0, DiskInt);
+
+    // the pending heap
+    Interrupt *heap = new Interrupt;
+    for (i = 0; i < numPending; i++) {
+	events[i]->when = 1 + Random() % BenchSpread;
+	events[i]->seq = heap->nextSeq++;
+	heap->HeapInsert(events[i]);
+    }
+    start = clock();
+    for (i = 0; i < numFires; i++) {
+	next = heap->HeapRemove(0);
+	next->when += 1 + Random() % BenchSpread;
+	next->seq = heap->nextSeq++;
+	heap->HeapInsert(next);
+    }
+    printf("heap:            %8.1f ns per interrupt\n",
+		NanosPer(start, numFires));
+    while (heap->numPending > 0)	// they aren't the heap's to delete
+	(void) heap->HeapRemove(0);
+    delete heap;
+
+    // the same again, on a sorted List
+    List *list = new List;
+    for (i = 0; i < numPending; i++)
+	list->SortedInsert((void *)events[i], 1 + Random() % BenchSpread);
+    start = clock();
+    for (i = 0; i < numFires; i++) {
+	next = (PendingInterrupt *)list->SortedRemove(&when);
+	list->SortedInsert((void *)next, when + 1 + Random() % BenchSpread);
+    }
+    printf("sorted list:     %8.1f ns per interrupt\n",
+		NanosPer(start, numFires));
+    delete list;
+
+    for (i = 0; i < numPending; i++)
+	delete events[i];
+    delete [] events;
+
+    // scheduling something that doesn't happen, like a timeout
+    start = clock();
+    for (i = 0; i < numFires; i++) {
+	when = 1 + Random() % BenchSpread;
+	bool cancelled = interrupt->Cancel(interrupt->Schedule(BenchDevice, 0,
+				when, DiskInt));
+	ASSERT(cancelled);
+    }
+    printf("schedule+cancel: %8.1f ns per interrupt\n",
+		NanosPer(start, numFires));
+
+    (void) interrupt->SetLevel(oldLevel);
+}
+#endif
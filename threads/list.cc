@@ -141,8 +141,8 @@ void
 List::Mapcar(VoidFunctionPtr func)
 {
     for (ListElement *ptr = first; ptr != NULL; ptr = ptr->next) {
-       DEBUG('l', "In mapcar, about to invoke %x(%x)\n", func, ptr->item);
-       (*func)((int)ptr->item);
+       DEBUG('l', "In mapcar, about to invoke %p(%p)\n", (void *) func, ptr->item);
+       (*func)((PtrInt)ptr->item);
     }
 }
 
@@ -8,7 +8,10 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -nh
+//		-sched <fifo|mlfq|priority|stride> -sr -tp <low> <high>
+//		-cpus <n> -ib <pending> <fires> -lp
+//		-rb <producers> <consumers> <items>
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
@@ -18,6 +21,19 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -nh keeps Nachos running when only the timer is left
+//    -sched chooses the scheduling policy (FIFO by default)
+//    -sr reports each thread's response and turnaround time (and, for
+//	stride scheduling, its share of the CPU against its tickets)
+//    -tp sets the low and high watermarks of the finished thread pool
+//    -cpus simulates a multiprocessor with that many CPUs, each on a
+//	host thread of its own (FIFO or priority scheduling only)
+//    -ib times the pending interrupt queue, with that many interrupts
+//	outstanding
+//    -lp reports how long threads waited on each lock, semaphore and
+//	condition, when Nachos halts
+//    -rb compares a RingBuffer with a lock and conditions, passing that
+//	many items from the producers to the consumers
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
@@ -59,6 +75,10 @@ extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
+#ifdef CHANGED
+extern void InterruptBenchmark(int numPending, int numFires);
+extern void RingBenchmark(int producers, int consumers, int items);
+#endif
 
 //----------------------------------------------------------------------
 // main
@@ -88,6 +108,18 @@ main(int argc, char **argv)
 
         if (!strcmp(*argv, "-z"))               // print copyright
             printf (copyright);
+#ifdef CHANGED
+	if (!strcmp(*argv, "-ib")) {		// time the interrupt queue
+	    ASSERT(argc > 2);
+	    InterruptBenchmark(atoi(*(argv + 1)), atoi(*(argv + 2)));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-rb")) {	// time the ring buffer
+	    ASSERT(argc > 3);
+	    RingBenchmark(atoi(*(argv + 1)), atoi(*(argv + 2)),
+			  atoi(*(argv + 3)));
+	    argCount = 4;
+	}
+#endif
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
@@ -14,7 +14,7 @@ BoundedBuffer *b;
 
 // Producer appends the string to the
 // buffer one character at a time.
-void Producer(int which)
+void Producer(PtrInt which)
 {
   char* hw = "Hello World";
 
@@ -28,7 +28,7 @@ void Producer(int which)
 
 
 // Consumer consumers items from the buffer.
-void Consumer(int which)
+void Consumer(PtrInt which)
 {
     int num;
     char *c;
@@ -60,7 +60,7 @@ void ProducerConsumer()
     {     
       name = (char *)malloc(sizeof(char) * 16);
       sprintf(name, "Producer %d", i);
-      producers[i] = new Thread(name);
+      producers[i] = threadPool->Get(name);
       producers[i]->Fork(Producer, i);
     }
 
@@ -68,7 +68,7 @@ void ProducerConsumer()
     {
       name = (char *)malloc(sizeof(char) * 16);
       sprintf(name, "Consumer %d", j);
-      consumers[j] = new Thread(name);
+      consumers[j] = threadPool->Get(name);
       consumers[j]->Fork(Consumer, j);
     }
 }
@@ -0,0 +1,211 @@
+// queue.cc
+//	Routines to manage an intrusive singly-linked queue.
+//
+//	Each item carries its own QueueLink, so nothing is allocated or
+//	freed as items come and go.  Each link remembers the queue it is
+//	on, which lets us catch an item being put on a second queue (or
+//	the same one twice) before it corrupts both.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+
+#include "copyright.h"
+#include "queue.h"
+
+//----------------------------------------------------------------------
+// QueueLink::QueueLink
+// 	Initialize a link, so it can be put on a queue.
+//
+//	"owner" is the object the link is embedded in; it is what the
+//		queue routines return.
+//----------------------------------------------------------------------
+
+QueueLink::QueueLink(void *owner)
+{
+    next = NULL;
+    key = 0;
+    item = owner;
+    queue = NULL;
+}
+
+//----------------------------------------------------------------------
+// Queue::Queue
+//	Initialize a queue, empty to start with.
+//----------------------------------------------------------------------
+
+Queue::Queue()
+{
+    first = last = NULL;
+}
+
+//----------------------------------------------------------------------
+// Queue::~Queue
+//	Prepare a queue for deallocation.  Anything still on it is taken
+//	off, so that its link can be used again; the items themselves
+//	belong to someone else.
+//----------------------------------------------------------------------
+
+Queue::~Queue()
+{
+    while (Remove() != NULL)
+	;
+}
+
+//----------------------------------------------------------------------
+// Queue::Append
+//      Append an item to the end of the queue.
+//
+//	"link" is the item's link, which must not be on any queue.
+//----------------------------------------------------------------------
+
+void
+Queue::Append(QueueLink *link)
+{
+    ASSERT(link->queue == NULL);
+    link->queue = this;
+    link->next = NULL;
+    if (IsEmpty())
+	first = link;
+    else
+	last->next = link;
+    last = link;
+}
+
+//----------------------------------------------------------------------
+// Queue::Prepend
+//      Put an item on the front of the queue.
+//
+//	"link" is the item's link, which must not be on any queue.
+//----------------------------------------------------------------------
+
+void
+Queue::Prepend(QueueLink *link)
+{
+    ASSERT(link->queue == NULL);
+    link->queue = this;
+    link->next = first;
+    if (IsEmpty())
+	last = link;
+    first = link;
+}
+
+//----------------------------------------------------------------------
+// Queue::Remove
+//      Remove the first item from the front of the queue.
+//
+// Returns:
+//	Pointer to removed item, NULL if nothing on the queue.
+//----------------------------------------------------------------------
+
+void *
+Queue::Remove()
+{
+    return SortedRemove(NULL);	// Same as SortedRemove, but ignore the key
+}
+
+//----------------------------------------------------------------------
+// Queue::Unlink
+//      Take an item off the queue, wherever it is on it.  This has to
+//	walk the queue to find the link before it.
+//
+// Returns:
+//	TRUE if the item was on this queue.
+//----------------------------------------------------------------------
+
+bool
+Queue::Unlink(QueueLink *link)
+{
+    QueueLink *prev = NULL;
+
+    if (link->queue != this)
+	return FALSE;
+    for (QueueLink *ptr = first; ptr != link; ptr = ptr->next) {
+	ASSERT(ptr != NULL);
+	prev = ptr;
+    }
+    if (prev == NULL)
+	first = link->next;
+    else
+	prev->next = link->next;
+    if (last == link)
+	last = prev;
+    link->next = NULL;
+    link->queue = NULL;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Queue::Mapcar
+//	Apply a function to each item on the queue, by walking through
+//	the queue, one link at a time.
+//
+//	"func" is the procedure to apply to each item on the queue.
+//----------------------------------------------------------------------
+
+void
+Queue::Mapcar(VoidFunctionPtr func)
+{
+    for (QueueLink *ptr = first; ptr != NULL; ptr = ptr->next)
+	(*func)((PtrInt)ptr->item);
+}
+
+//----------------------------------------------------------------------
+// Queue::SortedInsert
+//      Insert an item into a queue, so that the queue is sorted in
+//	increasing order by "sortKey".  Items with the same key stay in
+//	the order they were inserted, as with List::SortedInsert.
+//
+//	"link" is the item's link, which must not be on any queue.
+//	"sortKey" is the priority of the item.
+//----------------------------------------------------------------------
+
+void
+Queue::SortedInsert(QueueLink *link, int sortKey)
+{
+    QueueLink *ptr;
+
+    ASSERT(link->queue == NULL);
+    link->key = sortKey;
+    if (IsEmpty() || sortKey < first->key) {
+	Prepend(link);
+	return;
+    }
+    if (sortKey >= last->key) {		// the common case, for timers
+	Append(link);
+	return;
+    }
+    for (ptr = first; sortKey >= ptr->next->key; ptr = ptr->next)
+	;
+    link->queue = this;
+    link->next = ptr->next;
+    ptr->next = link;
+}
+
+//----------------------------------------------------------------------
+// Queue::SortedRemove
+//      Remove the first item from the front of a sorted queue.
+//
+// Returns:
+//	Pointer to removed item, NULL if nothing on the queue.
+//	Sets *keyPtr to the priority value of the removed item.
+//
+//	"keyPtr" is a pointer to the location in which to store the
+//		priority of the removed item, or NULL.
+//----------------------------------------------------------------------
+
+void *
+Queue::SortedRemove(int *keyPtr)
+{
+    QueueLink *link = first;
+
+    if (IsEmpty())
+	return NULL;
+
+    first = link->next;
+    if (first == NULL)
+	last = NULL;
+    if (keyPtr != NULL)
+	*keyPtr = link->key;
+    link->next = NULL;
+    link->queue = NULL;
+    return link->item;
+}
@@ -0,0 +1,73 @@
+// queue.h
+//	Data structures for intrusive queues.
+//
+//	A List allocates a ListElement for every item put on it, which
+//	means a trip through the heap every time a thread is made ready,
+//	waits on a semaphore, or an interrupt is scheduled.  A Queue
+//	instead links together QueueLinks embedded in the items
+//	themselves, so putting things on and taking them off never
+//	allocates.  The price is that an item can only be on as many
+//	queues at once as it has links -- a Thread, for instance, has one,
+//	shared by the ready queues and the synchronization wait queues,
+//	since a thread is never both ready and waiting.
+//
+//	Otherwise a Queue works like a List: items are "void *", and the
+//	"Sorted" routines keep the queue in increasing order by key.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+class Queue;
+
+// The following class defines the link that is embedded in anything
+// that is to be put on a Queue.  It is constructed with a pointer
+// to the object it is embedded in, which is what the Queue hands back.
+//
+// Internal data structures kept public so that Queue operations can
+// access them directly.
+
+class QueueLink {
+  public:
+    QueueLink(void *owner);	// initialize a link, on no queue
+
+    QueueLink *next;		// next link on the queue,
+				// NULL if this is the last
+    int key;			// priority, for a sorted queue
+    void *item;			// the object this link is part of
+    Queue *queue;		// the queue we're on, NULL if none
+};
+
+// The following class defines a "queue" -- a singly linked list of
+// QueueLinks.
+
+class Queue {
+  public:
+    Queue();			// initialize the queue
+    ~Queue();			// take everything off the queue
+
+    void Prepend(QueueLink *link);	// Put item at the beginning
+    void Append(QueueLink *link);	// Put item at the end
+    void *Remove();		// Take item off the front of the queue
+    bool Unlink(QueueLink *link);	// Take item off wherever it is;
+					// FALSE if it isn't on this queue
+
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every item
+					// on the queue
+    bool IsEmpty() { return first == NULL; }
+    QueueLink *Head() { return first; }	// for walking the queue in place
+
+    // Routines to put/get items on/off queue in order (sorted by key)
+    void SortedInsert(QueueLink *link, int sortKey);
+    void *SortedRemove(int *keyPtr); 	// Remove first item from queue
+
+  private:
+    QueueLink *first;  		// Head of the queue, NULL if empty
+    QueueLink *last;		// Last link on the queue
+};
+
+#endif // QUEUE_H
@@ -0,0 +1,212 @@
+// ringbench.cc
+//	Throughput benchmark for RingBuffer.
+//
+//	Producer threads hand "numItems" items in all to consumer threads
+//	through a buffer of RingBenchSize slots, three ways: a buffer
+//	guarded by a Lock and two Conditions, as BoundedBuffer is (less
+//	its printing); a RingBuffer an item at a time; and a RingBuffer
+//	in batches of RingBenchBatch.  For each we print the simulated
+//	ticks and the host time per item.
+//
+//	Run with "nachos -rb <producers> <consumers> <items>", and with
+//	-rs or -cpus to see them under preemption or on a multiprocessor.
+
+#ifdef CHANGED
+#include <time.h>
+#include "system.h"
+#include "synch.h"
+#include "ringbuffer.h"
+
+#define RingBenchSize	16		// slots in the buffer
+#define RingBenchBatch	8		// items per PutMany and GetMany
+
+enum RingBenchMode { LockedBuffer, RingSingle, RingBatched };
+
+static RingBenchMode mode;
+static int numProducers, numConsumers, totalItems;
+static Semaphore *finished;		// V'd by each thread as it ends
+static long long itemSum;		// of everything consumed
+
+// the buffer that BoundedBuffer would be
+static void *lockedSlots[RingBenchSize];
+static int lockedIn, lockedOut, lockedCount;
+static Lock *lockedMutex;
+static Condition *lockedEmpty, *lockedFull;
+
+static RingBuffer *ring;
+
+//----------------------------------------------------------------------
+// Share
+// 	How many of "total" items thread "which" of "n" should handle.
+//----------------------------------------------------------------------
+
+static int
+Share(int total, int n, int which)
+{
+    return total / n + (which < total % n ? 1 : 0);
+}
+
+//----------------------------------------------------------------------
+// LockedPut, LockedGet
+// 	BoundedBuffer's Append and Take.
+//----------------------------------------------------------------------
+
+static void
+LockedPut(void *item)
+{
+    lockedMutex->Acquire();
+    while (lockedCount == RingBenchSize)
+	lockedFull->Wait(lockedMutex);
+    lockedSlots[lockedIn] = item;
+    lockedIn = (lockedIn + 1) % RingBenchSize;
+    lockedCount++;
+    lockedEmpty->Signal(lockedMutex);
+    lockedMutex->Release();
+}
+
+static void *
+LockedGet()
+{
+    void *item;
+
+    lockedMutex->Acquire();
+    while (lockedCount == 0)
+	lockedEmpty->Wait(lockedMutex);
+    item = lockedSlots[lockedOut];
+    lockedOut = (lockedOut + 1) % RingBenchSize;
+    lockedCount--;
+    lockedFull->Signal(lockedMutex);
+    lockedMutex->Release();
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BenchProducer
+// 	Put items 1, 2, ... up to this producer's share.
+//----------------------------------------------------------------------
+
+static void
+BenchProducer(PtrInt which)
+{
+    void *batch[RingBenchBatch];
+    int n = Share(totalItems, numProducers, which);
+    int i, k;
+
+    for (i = 1; i <= n; ) {
+	switch (mode) {
+	  case LockedBuffer:
+	    LockedPut((void *)(PtrInt)i++);
+	    break;
+	  case RingSingle:
+	    ring->Put((void *)(PtrInt)i++);
+	    break;
+	  case RingBatched:
+	    for (k = 0; k < RingBenchBatch && i <= n; k++)
+		batch[k] = (void *)(PtrInt)i++;
+	    ring->PutMany(batch, k);
+	    break;
+	}
+    }
+    finished->V();
+}
+
+//----------------------------------------------------------------------
+// BenchConsumer
+// 	Take this consumer's share of the items, and add them up.
+//----------------------------------------------------------------------
+
+static void
+BenchConsumer(PtrInt which)
+{
+    void *batch[RingBenchBatch];
+    int n = Share(totalItems, numConsumers, which);
+    long long sum = 0;
+    int k;
+
+    while (n > 0) {
+	switch (mode) {
+	  case LockedBuffer:
+	    sum += (PtrInt)LockedGet();
+	    n--;
+	    break;
+	  case RingSingle:
+	    sum += (PtrInt)ring->Get();
+	    n--;
+	    break;
+	  case RingBatched:
+	    k = ring->GetMany(batch, min(n, RingBenchBatch));
+	    n -= k;
+	    while (k > 0)
+		sum += (PtrInt)batch[--k];
+	    break;
+	}
+    }
+    itemSum += sum;
+    finished->V();
+}
+
+//----------------------------------------------------------------------
+// RunBench
+// 	Run the producers and consumers to completion in one mode, check
+//	that every item arrived, and print the time it took.
+//----------------------------------------------------------------------
+
+static void
+RunBench(RingBenchMode m, char *label)
+{
+    long long expected = 0;
+    int startTicks = stats->totalTicks;
+    clock_t start = clock();
+    int i, n;
+
+    mode = m;
+    itemSum = 0;
+    for (i = 0; i < numProducers; i++) {
+	n = Share(totalItems, numProducers, i);
+	expected += (long long)n * (n + 1) / 2;
+	threadPool->Get("producer")->Fork(BenchProducer, i);
+    }
+    for (i = 0; i < numConsumers; i++)
+	threadPool->Get("consumer")->Fork(BenchConsumer, i);
+    finished->P(numProducers + numConsumers);
+    ASSERT(itemSum == expected);
+
+    printf("%-16s %8.2f ticks, %8.1f ns per item\n", label,
+	   (double)(stats->totalTicks - startTicks) / totalItems,
+	   (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / totalItems);
+}
+
+//----------------------------------------------------------------------
+// RingBenchmark
+// 	main.cc calls this function.
+//----------------------------------------------------------------------
+
+void
+RingBenchmark(int producers, int consumers, int items)
+{
+    ASSERT(producers > 0 && consumers > 0 && items > 0);
+    numProducers = producers;
+    numConsumers = consumers;
+    totalItems = items;
+    finished = new Semaphore("ring bench finished", 0);
+    printf("Ring benchmark: %d producers, %d consumers, %d items, "
+	   "%d slots\n", producers, consumers, items, RingBenchSize);
+
+    lockedIn = lockedOut = lockedCount = 0;
+    lockedMutex = new Lock("ring bench lock");
+    lockedEmpty = new Condition("ring bench empty");
+    lockedFull = new Condition("ring bench full");
+    RunBench(LockedBuffer, "lock+conditions");
+    delete lockedMutex;
+    delete lockedEmpty;
+    delete lockedFull;
+
+    ring = new RingBuffer("ring bench", RingBenchSize);
+    RunBench(RingSingle, "ring");
+    RunBench(RingBatched, "ring, batched");
+    if (DebugIsEnabled('t'))
+	ring->Print();
+    delete ring;
+    delete finished;
+}
+#endif
@@ -0,0 +1,301 @@
+// ringbuffer.cc
+//	Routines for a bounded queue of items, shared between any number
+//	of producer and consumer threads.
+//
+//	BoundedBuffer takes a Lock and waits on a Condition for every
+//	item, so each item costs a lock acquire and release, a signal,
+//	and, whenever the other side is waiting, a trip through the lock's
+//	queue.  A RingBuffer instead has no lock.  Putting or getting
+//	items is a short stretch with interrupts off -- the kernel's
+//	primitive atomic operation, as for semaphores -- and a thread
+//	blocks only when the ring is really full or empty.
+//
+//	Each slot carries a sequence number (after Vyukov's bounded MPMC
+//	queue).  A producer at position "pos" may fill the slot when its
+//	number is "pos"; filling it sets the number to "pos + 1", which is
+//	what the consumer at "pos" waits for; emptying it sets it to
+//	"pos + size", ready for the producer one lap later.  So claiming
+//	slots (moving "tail" or "head" on) is separate from filling or
+//	emptying them: PutMany and GetMany claim a run of slots, copy the
+//	batch with interrupts back on, while other threads claim the slots
+//	beyond, and then publish them.  A single item isn't worth turning
+//	interrupts on and off again for, so it is copied in place.
+//
+//	Whoever publishes slots wakes as many waiters on the other side as
+//	there are slots ready for them, in order from "head" (or "tail").
+//	A slot published ahead of one that is still being filled doesn't
+//	wake anyone; publishing the earlier one wakes for both.
+//
+//	This is safe with more than one CPU, as the simulated CPUs only
+//	switch when a thread enables interrupts.
+
+#include "copyright.h"
+#include "ringbuffer.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// RingBuffer::RingBuffer
+// 	Initialize an empty ring.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"minSize" is the number of items it must hold; it is rounded up
+//		to a power of two.
+//----------------------------------------------------------------------
+
+RingBuffer::RingBuffer(char *debugName, int minSize)
+{
+    ASSERT(minSize > 0);
+    name = debugName;
+    for (size = 1; size < (unsigned)minSize; size <<= 1)
+	;
+    mask = size - 1;
+    slots = new RingSlot[size];
+    for (unsigned i = 0; i < size; i++) {
+	slots[i].seq = i;		// free, for the first lap
+	slots[i].item = NULL;
+    }
+    head = tail = 0;
+    putters = new Queue;
+    getters = new Queue;
+    puts = gets = putBatches = getBatches = putWaits = getWaits = 0;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::~RingBuffer
+// 	De-allocate the ring.  No one may be waiting on it; any items
+//	left in it belong to whoever put them there.
+//----------------------------------------------------------------------
+
+RingBuffer::~RingBuffer()
+{
+    ASSERT(putters->IsEmpty() && getters->IsEmpty());
+    delete [] slots;
+    delete putters;
+    delete getters;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::Claim
+// 	Reserve up to "n" consecutive slots starting at "*next", which is
+//	either "tail" or "head", and move it on past them.  A slot can be
+//	claimed when its number is its position plus "offset": 0 for a
+//	free slot, 1 for a full one.  Interrupts must be off.
+//
+// Returns:
+//	The number of slots claimed, which is 0 if the first isn't ready.
+//----------------------------------------------------------------------
+
+int
+RingBuffer::Claim(unsigned *next, int n, unsigned offset)
+{
+    int k = 0;
+
+    while (k < n && slots[(*next + k) & mask].seq == *next + k + offset)
+	k++;
+    *next += k;
+    return k;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::Publish
+// 	Hand "n" slots starting at "pos", just filled or emptied, to the
+//	other side: set each one's number to its position plus "offset",
+//	1 for a filled slot, "size" for an emptied one.  Interrupts must
+//	be off.
+//----------------------------------------------------------------------
+
+void
+RingBuffer::Publish(unsigned pos, int n, unsigned offset)
+{
+    for (int i = 0; i < n; i++)
+	slots[(pos + i) & mask].seq = pos + i + offset;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::Wake
+// 	Make ready one waiter for each slot, from "pos" on, that is ready
+//	for them to claim (see Claim for "offset"), or until no one is
+//	left waiting.  Interrupts must be off.
+//----------------------------------------------------------------------
+
+void
+RingBuffer::Wake(Queue *waiters, unsigned pos, unsigned offset)
+{
+    for (; !waiters->IsEmpty() && slots[pos & mask].seq == pos + offset; pos++)
+	scheduler->ReadyToRun((Thread *)waiters->Remove());
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::TryPut
+// 	Put an item in the ring, if there's room.
+//
+// Returns:
+//	FALSE if the ring is full.
+//----------------------------------------------------------------------
+
+bool
+RingBuffer::TryPut(void *item)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    unsigned pos = tail;
+    bool room = (Claim(&tail, 1, 0) == 1);
+
+    ASSERT(item != NULL);
+    if (room) {
+	slots[pos & mask].item = item;
+	Publish(pos, 1, 1);
+	Wake(getters, head, 1);
+	puts++;
+	putBatches++;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return room;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::TryGet
+// 	Take the next item out of the ring, if there is one.
+//
+// Returns:
+//	The item, or NULL if the ring is empty.
+//----------------------------------------------------------------------
+
+void *
+RingBuffer::TryGet()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    unsigned pos = head;
+    void *item = NULL;
+
+    if (Claim(&head, 1, 1) == 1) {
+	item = slots[pos & mask].item;
+	Publish(pos, 1, size);
+	Wake(putters, tail, 0);
+	gets++;
+	getBatches++;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::Put
+// 	Put an item in the ring, waiting for room if it is full.
+//----------------------------------------------------------------------
+
+void
+RingBuffer::Put(void *item)
+{
+    PutMany(&item, 1);
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::Get
+// 	Take the next item out of the ring, waiting for one if it is empty.
+//----------------------------------------------------------------------
+
+void *
+RingBuffer::Get()
+{
+    void *item;
+
+    (void) GetMany(&item, 1);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::PutMany
+// 	Put "n" items in the ring, in order, as many at a time as there is
+//	room for, and waiting for more room while there isn't any.
+//
+//	"items" is an array of "n" items, none of them NULL.
+//----------------------------------------------------------------------
+
+void
+RingBuffer::PutMany(void **items, int n)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    unsigned pos;
+    int done = 0, k, i;
+
+    while (done < n) {
+	pos = tail;
+	k = Claim(&tail, n - done, 0);
+	if (k == 0) {			// full
+	    putWaits++;
+	    putters->Append(&currentThread->queueLink);
+	    currentThread->Sleep();
+	    continue;
+	}
+	if (k > 1)
+	    (void) interrupt->SetLevel(oldLevel);
+	for (i = 0; i < k; i++) {
+	    ASSERT(items[done + i] != NULL);
+	    slots[(pos + i) & mask].item = items[done + i];
+	}
+	if (k > 1)
+	    (void) interrupt->SetLevel(IntOff);
+	Publish(pos, k, 1);
+	Wake(getters, head, 1);
+	putBatches++;
+	done += k;
+    }
+    puts += n;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::GetMany
+// 	Take up to "max" items out of the ring, in order, waiting if it is
+//	empty.  Doesn't wait for more once it has some.
+//
+//	"items" is an array with room for "max" items.
+//
+// Returns:
+//	The number of items taken, at least 1.
+//----------------------------------------------------------------------
+
+int
+RingBuffer::GetMany(void **items, int max)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    unsigned pos;
+    int k, i;
+
+    ASSERT(max > 0);
+    for (;;) {
+	pos = head;
+	k = Claim(&head, max, 1);
+	if (k > 0)
+	    break;
+	getWaits++;			// empty
+	getters->Append(&currentThread->queueLink);
+	currentThread->Sleep();
+    }
+    if (k > 1)
+	(void) interrupt->SetLevel(oldLevel);
+    for (i = 0; i < k; i++)
+	items[i] = slots[(pos + i) & mask].item;
+    if (k > 1)
+	(void) interrupt->SetLevel(IntOff);
+    Publish(pos, k, size);
+    Wake(putters, tail, 0);
+    gets += k;
+    getBatches++;
+    (void) interrupt->SetLevel(oldLevel);
+    return k;
+}
+
+//----------------------------------------------------------------------
+// RingBuffer::Print
+// 	Print how many items went through the ring, in how many batches,
+//	and how often threads had to wait.
+//----------------------------------------------------------------------
+
+void
+RingBuffer::Print()
+{
+    printf("Ring \"%s\" (%u slots): put %d in %d batches, %d waits; "
+	   "got %d in %d batches, %d waits\n", name, size, puts, putBatches,
+	   putWaits, gets, getBatches, getWaits);
+}
@@ -0,0 +1,71 @@
+// ringbuffer.h
+//	Data structures for a bounded queue shared by any number of
+//	producer and consumer threads.
+//
+//	See ringbuffer.cc for the details.
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include "copyright.h"
+#include "queue.h"
+
+// The following class defines one slot of a ring.  "seq" says what the
+// slot is waiting for: when it equals a producer's position, the slot
+// is free for that producer to fill; when it equals a consumer's
+// position plus one, it holds the item for that consumer.
+
+class RingSlot {
+  public:
+    unsigned seq;
+    void *item;
+};
+
+// The following class defines a bounded multi-producer, multi-consumer
+// ring of "void *" items.  Items may not be NULL.  Put and Get block
+// only when the ring is full or empty; the "Try" versions return
+// instead.  PutMany and GetMany move a batch of items at a time.
+
+class RingBuffer {
+  public:
+    RingBuffer(char *debugName, int minSize);	// room for at least
+						// "minSize" items
+    ~RingBuffer();
+
+    void Put(void *item);		// wait until there's room
+    void *Get();			// wait until there's an item
+    bool TryPut(void *item);		// FALSE if the ring is full
+    void *TryGet();			// NULL if the ring is empty
+
+    void PutMany(void **items, int n);	// put all "n", waiting for room
+					// as need be
+    int GetMany(void **items, int max);	// take between 1 and "max",
+					// waiting if there are none
+
+    char *getName() { return name; }
+    void Print();			// items moved, and waits
+
+  private:
+    int Claim(unsigned *pos, int n, unsigned offset);
+					// reserve slots to fill or empty
+    void Publish(unsigned pos, int n, unsigned offset);
+					// hand them to the other side
+    void Wake(Queue *waiters, unsigned pos, unsigned offset);
+					// as many waiters as there are slots
+					// ready for them
+
+    char *name;
+    RingSlot *slots;
+    unsigned size;			// a power of two
+    unsigned mask;			// size - 1
+    unsigned tail;			// next position to put into
+    unsigned head;			// next position to get from
+    Queue *putters;			// threads waiting for a free slot
+    Queue *getters;			// threads waiting for an item
+
+    int puts, gets;			// items moved
+    int putBatches, getBatches;		// claims made
+    int putWaits, getWaits;		// times a thread had to block
+};
+
+#endif // RINGBUFFER_H
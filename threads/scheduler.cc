@@ -11,8 +11,11 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	The default is a very simple implementation -- no priorities,
+//	straight FIFO.  A multilevel feedback queue, strict priorities or
+//	stride scheduling can be chosen instead (see scheduler.h).  Under
+//	any of them, periodic real-time threads run first, earliest
+//	deadline first.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -27,10 +30,36 @@
 // 	Initialize the list of ready but not running threads to empty.
 //----------------------------------------------------------------------
 
+#ifdef CHANGED
+Scheduler::Scheduler(SchedulerPolicy schedPolicy, bool printReport)
+{ 
+    readyList = new Queue; 
+    policy = schedPolicy;
+    for (int i = 0; i < MLFQLevels; i++)
+	levels[i] = new Queue;
+    nextBoost = MLFQBoostTicks;
+    for (int i = 0; i < NumPriorities; i++)
+	priorityQueues[i] = new Queue;
+    readyMask = 0;
+    heapCapacity = 16;
+    strideHeap = new Thread*[heapCapacity];
+    heapSize = 0;
+    globalPass = 0;
+    lastCharge = lastIdle = 0;
+    numAccounts = 0;
+    rtReady = new Queue;
+    rtSleeping = new Queue;
+    rtUtilization = 0;
+    rtJobs = rtMisses = rtOverruns = 0;
+    report = printReport;
+    threadsFinished = totalResponse = totalTurnaround = 0;
+} 
+#else
 Scheduler::Scheduler()
 { 
     readyList = new List; 
 } 
+#endif
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
@@ -40,6 +69,15 @@ Scheduler::Scheduler()
 Scheduler::~Scheduler()
 { 
     delete readyList; 
+#ifdef CHANGED
+    for (int i = 0; i < MLFQLevels; i++)
+	delete levels[i];
+    for (int i = 0; i < NumPriorities; i++)
+	delete priorityQueues[i];
+    delete [] strideHeap;
+    delete rtReady;
+    delete rtSleeping;
+#endif
 } 
 
 //----------------------------------------------------------------------
@@ -55,10 +93,76 @@ Scheduler::ReadyToRun (Thread *thread)
 {
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
+#ifdef CHANGED
+    if (thread->getStatus() == BLOCKED)	// since Thread::Sleep
+	thread->Account(0, 0, stats->totalTicks - thread->blockedAt, 0);
+    if (thread->isRealTime()) {
+	thread->setStatus(READY);
+	rtReady->SortedInsert(&thread->queueLink, thread->deadline);
+	if (thread != currentThread && (!currentThread->isRealTime()
+		|| thread->deadline < currentThread->deadline))
+	    interrupt->YieldSoon();	// preempt the running thread
+	return;
+    }
+    if (policy == MLFQPolicy) {
+	if (thread->getStatus() == BLOCKED && thread->level > 0) {
+	    thread->level--;		// gave up the CPU early: reward it
+	    thread->quantumUsed = 0;
+	}
+	thread->setStatus(READY);
+	levels[thread->level]->Append(&thread->queueLink);
+	return;
+    }
+    if (policy == PriorityPolicy) {
+	thread->setStatus(READY);
+	priorityQueues[thread->priority]->Append(&thread->queueLink);
+	readyMask |= (1u << thread->priority);
+	if (thread != currentThread && thread->priority > currentThread->priority)
+	    interrupt->YieldSoon();	// preempt the running thread
+	WakeIdleCpu(thread);
+	return;
+    }
+    if (policy == StridePolicy) {
+	if (thread == currentThread)	// yielding: charge it before it
+	    Charge(thread);		// goes in the heap
+	else if (PassBefore(thread->pass, globalPass))
+	    thread->pass = globalPass;	// no credit for time spent away
+	thread->setStatus(READY);
+	HeapInsert(thread);
+	return;
+    }
+#endif
     thread->setStatus(READY);
+#ifdef CHANGED
+    if (numCpus > 1)
+	currentCpu->Enqueue(thread);	// run it here, unless another CPU
+    else				// runs out of work first
+	readyList->Append(&thread->queueLink);
+    WakeIdleCpu(thread);
+#else
     readyList->Append((void *)thread);
+#endif
 }
 
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Scheduler::WakeIdleCpu
+// 	With more than one CPU, a thread just made ready might as well
+//	run on a CPU that has nothing to do.  Send one an IPI, so it
+//	comes and looks.  (A thread yielding needn't bother: it is about
+//	to look itself.)
+//----------------------------------------------------------------------
+
+void
+Scheduler::WakeIdleCpu(Thread *thread)
+{
+    Cpu *cpu;
+
+    if (numCpus > 1 && thread != currentThread && (cpu = IdleCpu()) != NULL)
+	interrupt->SendIPI(cpu);
+}
+#endif
+
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
 // 	Return the next thread to be scheduled onto the CPU.
@@ -70,9 +174,69 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
+#ifdef CHANGED
+    if (!rtReady->IsEmpty())
+	return (Thread *)rtReady->SortedRemove(NULL);
+    if (policy == MLFQPolicy) {
+	for (int i = 0; i < MLFQLevels; i++)
+	    if (!levels[i]->IsEmpty())
+		return (Thread *)levels[i]->Remove();
+	return NULL;
+    }
+    if (policy == PriorityPolicy) {
+	int p = HighestReady();
+	if (p < 0)
+	    return NULL;
+	Thread *thread = (Thread *)priorityQueues[p]->Remove();
+	if (priorityQueues[p]->IsEmpty())
+	    readyMask &= ~(1u << p);
+	return thread;
+    }
+    if (policy == StridePolicy) {
+	Thread *thread = HeapRemoveMin();
+	if (thread != NULL)
+	    globalPass = thread->pass;
+	return thread;
+    }
+    if (numCpus > 1) {
+	Thread *thread = currentCpu->Dequeue();
+	return (thread != NULL) ? thread : StealWork();
+    }
+#endif
     return (Thread *)readyList->Remove();
 }
 
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Scheduler::StealWork
+// 	Our run queue is empty: take a thread from the back of another
+//	CPU's.  We start looking at a random CPU, so that CPUs that are
+//	out of work don't all descend on the same one.
+//
+// Returns:
+//	The thread, or NULL if every run queue is empty.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::StealWork()
+{
+    int start = Random() % numCpus;
+
+    for (int i = 0; i < numCpus; i++) {
+	Cpu *victim = cpus[(start + i) % numCpus];
+	if (victim == currentCpu || victim->QueueLength() == 0)
+	    continue;
+	Thread *thread = victim->Steal();
+	DEBUG('t', "CPU %d stole thread \"%s\" from CPU %d\n",
+	      currentCpu->id, thread->getName(), victim->id);
+	currentCpu->steals++;
+	victim->stolen++;
+	return thread;
+    }
+    return NULL;
+}
+#endif
+
 //----------------------------------------------------------------------
 // Scheduler::Run
 // 	Dispatch the CPU to nextThread.  Save the state of the old thread,
@@ -101,9 +265,18 @@ Scheduler::Run (Thread *nextThread)
     
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
+#ifdef CHANGED
+    Charge(oldThread);			    // for the ticks it just used
+    if (nextThread != oldThread)	    // not just waking from idle
+	oldThread->Account(0, 0, 0, 1);
+#endif
 
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
+#ifdef CHANGED
+    if (currentThread->firstRunAt < 0)	    // for its response time
+	currentThread->firstRunAt = stats->totalTicks;
+#endif
     
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
@@ -122,7 +295,11 @@ Scheduler::Run (Thread *nextThread)
     // before now (for example, in Thread::Finish()), because up to this
     // point, we were still running on the old thread's stack!
     if (threadToBeDestroyed != NULL) {
+#ifdef CHANGED
+	threadPool->Put(threadToBeDestroyed);	// stack and all, for reuse
+#else
         delete threadToBeDestroyed;
+#endif
 	threadToBeDestroyed = NULL;
     }
     
@@ -143,5 +320,485 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
+#ifdef CHANGED
+    if (!rtReady->IsEmpty()) {
+	printf("  real-time: ");
+	rtReady->Mapcar((VoidFunctionPtr) ThreadPrint);
+	printf("\n");
+    }
+    if (policy == MLFQPolicy) {
+	for (int i = 0; i < MLFQLevels; i++) {
+	    printf("  level %d: ", i);
+	    levels[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+	    printf("\n");
+	}
+	return;
+    }
+    if (policy == PriorityPolicy) {
+	for (int p = NumPriorities - 1; p >= 0; p--)
+	    if (!priorityQueues[p]->IsEmpty()) {
+		printf("  priority %d: ", p);
+		priorityQueues[p]->Mapcar((VoidFunctionPtr) ThreadPrint);
+		printf("\n");
+	    }
+	return;
+    }
+    if (policy == StridePolicy) {	// in heap order, not pass order
+	for (int i = 0; i < heapSize; i++)
+	    printf("%s (pass %u), ", strideHeap[i]->getName(),
+		   strideHeap[i]->pass);
+	printf("\n");
+	return;
+    }
+    if (numCpus > 1) {
+	for (int i = 0; i < numCpus; i++)
+	    printf("  CPU %d: %d threads\n", i, cpus[i]->QueueLength());
+	return;
+    }
+#endif
     readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
 }
+
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Scheduler::TimerTick
+// 	Called by the timer interrupt handler, with interrupts off, to
+//	decide whether to preempt the running thread.
+//
+//	FIFO always time-slices, and the priority policy time-slices
+//	between threads of the same priority.  Under stride scheduling the
+//	running thread gives up the CPU whenever anything else is ready,
+//	so that the least pass is chosen again.  Under MLFQ the running
+//	thread is charged for the tick, and moved down a level once it has
+//	used its quantum; it is only preempted then, or if a higher level
+//	thread is waiting.
+//
+//	A real-time thread is only preempted here if it has overrun its
+//	budget; it then finishes its job as an ordinary thread.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::TimerTick()
+{
+    if (currentThread->isRealTime()) {
+	Thread *rt = currentThread;
+	if (rt->cpuTicks + Uncharged() - rt->jobStart < rt->budget)
+	    return FALSE;
+	DEBUG('t', "Real-time thread \"%s\" overran its budget\n",
+	      rt->getName());
+	rt->throttled = TRUE;
+	rt->overruns++;
+	rtOverruns++;
+	return TRUE;
+    }
+    if (!rtReady->IsEmpty())
+	return TRUE;
+    if (policy == PriorityPolicy)	// round robin within a priority
+	return HighestReady() >= currentThread->priority;
+    if (policy == StridePolicy)
+	return heapSize > 0;
+    if (policy != MLFQPolicy)
+	return TRUE;
+
+    if (stats->totalTicks >= nextBoost) {
+	Boost();
+	nextBoost = stats->totalTicks + MLFQBoostTicks;
+    }
+
+    Thread *thread = currentThread;
+    if (++thread->quantumUsed >= MLFQQuantum(thread->level)) {
+	if (thread->level < MLFQLevels - 1)
+	    thread->level++;
+	thread->quantumUsed = 0;
+	DEBUG('t', "Thread \"%s\" used its quantum, now at level %d\n",
+	      thread->getName(), thread->level);
+	return TRUE;
+    }
+    for (int i = 0; i < thread->level; i++)
+	if (!levels[i]->IsEmpty())
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move every thread, running or ready, back to level 0.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost()
+{
+    Thread *thread;
+
+    DEBUG('t', "Boosting all threads to level 0\n");
+    for (int i = 1; i < MLFQLevels; i++)
+	while ((thread = (Thread *)levels[i]->Remove()) != NULL) {
+	    thread->level = 0;
+	    thread->quantumUsed = 0;
+	    levels[0]->Append(&thread->queueLink);
+	}
+    currentThread->level = 0;
+    currentThread->quantumUsed = 0;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ThreadFinished
+// 	"thread" is finishing.  Its response time is from creation until it
+//	first ran, and its turnaround time from creation until now.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ThreadFinished(Thread *thread)
+{
+    int response = thread->firstRunAt - thread->createdAt;
+    int turnaround = stats->totalTicks - thread->createdAt;
+
+    threadsFinished++;
+    totalResponse += response;
+    totalTurnaround += turnaround;
+    if (report) {
+	printf("Thread \"%s\": response %d, turnaround %d ticks\n",
+	       thread->getName(), response, turnaround);
+	printf("Thread \"%s\": user %d, system %d, blocked %d ticks, "
+	       "%d switches\n", thread->getName(), thread->usage.userTicks,
+	       thread->usage.systemTicks, thread->usage.blockedTicks,
+	       thread->usage.switches);
+    }
+
+    if (thread->period > 0) {
+	rtUtilization -= divRoundUp(thread->budget * EDFMaxUtilization,
+				    thread->period);
+	if (report)
+	    printf("Thread \"%s\": %d jobs, %d deadline misses, "
+		   "%d overruns\n", thread->getName(), thread->jobsDone,
+		   thread->deadlineMisses, thread->overruns);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Report
+// 	Print the average response and turnaround times, if asked for.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Report()
+{
+    if (!report)
+	return;
+    if (policy == StridePolicy) {
+	Charge(currentThread);		// bring the running thread up to date
+	StrideReport();
+    }
+    if (rtJobs > 0)
+	printf("Real-time: %d jobs, %d deadline misses, %d overruns\n",
+	       rtJobs, rtMisses, rtOverruns);
+    if (threadsFinished == 0)
+	return;
+    static char *policyNames[] = { "FIFO", "MLFQ", "priority", "stride" };
+
+    printf("Scheduler: %s, %d threads finished, average response %d, "
+	   "turnaround %d ticks\n", policyNames[policy],
+	   threadsFinished, totalResponse / threadsFinished,
+	   totalTurnaround / threadsFinished);
+}
+//----------------------------------------------------------------------
+// Scheduler::SetPriority
+// 	Schedule "thread" at "priority" from now on.  A ready thread is
+//	moved to its new queue; if the running thread drops below a ready
+//	one, it gives up the CPU.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetPriority(Thread *thread, int priority)
+{
+    ASSERT(priority >= 0 && priority < NumPriorities);
+    if (policy != PriorityPolicy || thread->priority == priority) {
+	thread->priority = priority;
+	return;
+    }
+    DEBUG('t', "Thread \"%s\" priority %d -> %d\n", thread->getName(),
+	  thread->priority, priority);
+
+    if (thread->getStatus() == READY) {
+	Queue *queue = priorityQueues[thread->priority];
+
+	queue->Unlink(&thread->queueLink);
+	if (queue->IsEmpty())
+	    readyMask &= ~(1u << thread->priority);
+
+	thread->priority = priority;
+	priorityQueues[priority]->Append(&thread->queueLink);
+	readyMask |= (1u << priority);
+	if (priority > currentThread->priority)
+	    interrupt->YieldSoon();
+    } else {
+	thread->priority = priority;
+	if (thread == currentThread && HighestReady() > priority)
+	    interrupt->YieldSoon();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HighestReady
+// 	Find the most urgent non-empty ready queue from "readyMask", by
+//	binary search for its highest set bit.
+//----------------------------------------------------------------------
+
+int
+Scheduler::HighestReady()
+{
+    unsigned int mask = readyMask;
+    int bit = 0;
+
+    if (mask == 0)
+	return -1;
+    if (mask & 0xffff0000) { mask >>= 16; bit += 16; }
+    if (mask & 0xff00) { mask >>= 8; bit += 8; }
+    if (mask & 0xf0) { mask >>= 4; bit += 4; }
+    if (mask & 0xc) { mask >>= 2; bit += 2; }
+    if (mask & 0x2) bit += 1;
+    return bit;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Charge "thread", which has been running, for the CPU it has used
+//	since it was last charged: simulated ticks less any spent idle
+//	(a thread going to sleep stays "current" while we wait for an
+//	interrupt).  Under stride scheduling its pass advances by its
+//	stride for each tick.  Called at every context switch, from Run.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge(Thread *thread)
+{
+    int used = Uncharged();
+
+    lastCharge = stats->totalTicks;
+    lastIdle = stats->idleTicks;
+    thread->cpuTicks += used;
+    if (policy != StridePolicy)
+	return;
+
+    thread->pass += (unsigned int)used * (unsigned int)thread->stride;
+    if (thread->account < 0 && numAccounts < MaxAccounts) {
+	CpuAccount *acct = &accounts[numAccounts];
+	strncpy(acct->name, thread->getName(), AccountNameLen - 1);
+	acct->name[AccountNameLen - 1] = '\0';
+	acct->ticks = 0;
+	thread->account = numAccounts++;
+    }
+    if (thread->account >= 0) {
+	accounts[thread->account].tickets = thread->tickets;
+	accounts[thread->account].ticks += used;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::StrideReport
+// 	Compare each thread's share of the CPU with its share of the
+//	tickets.  The target assumes every thread was competing for the
+//	whole run, so it is only meaningful for threads that were.
+//----------------------------------------------------------------------
+
+void
+Scheduler::StrideReport()
+{
+    int totalTickets = 0, totalTicks = 0;
+
+    for (int i = 0; i < numAccounts; i++) {
+	totalTickets += accounts[i].tickets;
+	totalTicks += accounts[i].ticks;
+    }
+    if (totalTicks == 0)
+	return;
+
+    printf("Stride shares:\n");
+    printf("  %-*s %8s %8s %8s %8s\n", AccountNameLen, "thread",
+	   "tickets", "ticks", "target%", "actual%");
+    for (int i = 0; i < numAccounts; i++)
+	printf("  %-*s %8d %8d %8.1f %8.1f\n", AccountNameLen,
+	       accounts[i].name, accounts[i].tickets, accounts[i].ticks,
+	       100.0 * accounts[i].tickets / totalTickets,
+	       100.0 * accounts[i].ticks / totalTicks);
+    if (numAccounts == MaxAccounts)
+	printf("  (only the first %d threads are shown)\n", MaxAccounts);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HeapInsert, Scheduler::HeapRemoveMin
+// 	The stride scheduler's ready threads, kept as a binary min-heap
+//	on pass in "strideHeap", which doubles in size when it fills.
+//----------------------------------------------------------------------
+
+void
+Scheduler::HeapInsert(Thread *thread)
+{
+    if (heapSize == heapCapacity) {
+	Thread **bigger = new Thread*[2 * heapCapacity];
+	for (int i = 0; i < heapSize; i++)
+	    bigger[i] = strideHeap[i];
+	delete [] strideHeap;
+	strideHeap = bigger;
+	heapCapacity *= 2;
+    }
+
+    int i = heapSize++;
+    while (i > 0) {			// sift up
+	int parent = (i - 1) / 2;
+	if (!PassBefore(thread->pass, strideHeap[parent]->pass))
+	    break;
+	strideHeap[i] = strideHeap[parent];
+	i = parent;
+    }
+    strideHeap[i] = thread;
+}
+
+Thread *
+Scheduler::HeapRemoveMin()
+{
+    if (heapSize == 0)
+	return NULL;
+
+    Thread *min = strideHeap[0];
+    Thread *last = strideHeap[--heapSize];
+    int i = 0;
+
+    for (;;) {				// sift "last" down from the root
+	int child = 2 * i + 1;
+	if (child >= heapSize)
+	    break;
+	if (child + 1 < heapSize
+		&& PassBefore(strideHeap[child + 1]->pass, strideHeap[child]->pass))
+	    child++;
+	if (!PassBefore(strideHeap[child]->pass, last->pass))
+	    break;
+	strideHeap[i] = strideHeap[child];
+	i = child;
+    }
+    if (heapSize > 0)
+	strideHeap[i] = last;
+    return min;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Uncharged
+// 	How long the running thread has been on the CPU since it was
+//	last charged.
+//----------------------------------------------------------------------
+
+int
+Scheduler::Uncharged()
+{
+    return (stats->totalTicks - lastCharge) - (stats->idleTicks - lastIdle);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::AdmitRealTime
+// 	Make "thread" periodic if the real-time threads' total
+//	utilization, budget / period, stays within EDFMaxUtilization;
+//	otherwise leave it alone and return FALSE.  "thread" is either
+//	not yet forked, or the running thread.  Its first job is released
+//	now.  The real-time class needs the timer, so start it if it
+//	isn't already running.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::AdmitRealTime(Thread *thread, int period, int budget)
+{
+    int u = divRoundUp(budget * EDFMaxUtilization, period);
+
+    ASSERT(thread == currentThread || thread->getStatus() == JUST_CREATED);
+    if (numCpus > 1) {			// EDF here is for one CPU
+	DEBUG('t', "Real-time thread \"%s\" not admitted: %d CPUs\n",
+	      thread->getName(), numCpus);
+	return FALSE;
+    }
+    if (rtUtilization + u > EDFMaxUtilization) {
+	DEBUG('t', "Real-time thread \"%s\" not admitted: utilization "
+	      "%d + %d\n", thread->getName(), rtUtilization, u);
+	return FALSE;
+    }
+    rtUtilization += u;
+
+    thread->period = period;
+    thread->budget = budget;
+    thread->deadline = stats->totalTicks + period;
+    thread->jobStart = thread->cpuTicks;
+    if (thread == currentThread)
+	thread->jobStart += Uncharged();
+    thread->throttled = FALSE;
+    DEBUG('t', "Real-time thread \"%s\": period %d, budget %d\n",
+	  thread->getName(), period, budget);
+
+    StartTimer();
+    if (thread == currentThread && !rtReady->IsEmpty())
+	interrupt->YieldSoon();		// let an earlier deadline go first
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::EndOfJob
+// 	The running periodic thread, "thread", has finished this period's
+//	job.  Count a deadline miss if it is late, and one for each later
+//	period it has let go by entirely.  Then sleep until the next
+//	release, or if that has come already, start the next job now.
+//----------------------------------------------------------------------
+
+void
+Scheduler::EndOfJob(Thread *thread)
+{
+    int now = stats->totalTicks;
+    int release = thread->deadline;
+
+    thread->jobsDone++;
+    rtJobs++;
+    if (now > thread->deadline) {
+	DEBUG('t', "Real-time thread \"%s\" missed its deadline at %d\n",
+	      thread->getName(), thread->deadline);
+	thread->deadlineMisses++;
+	rtMisses++;
+    }
+    while (release + thread->period <= now) {
+	release += thread->period;
+	thread->deadlineMisses++;
+	rtMisses++;
+    }
+
+    if (release > now) {
+	rtSleeping->SortedInsert(&thread->queueLink, release);
+	thread->Sleep();		// until ReleaseJobs
+    } else {
+	thread->deadline = release + thread->period;
+	thread->jobStart = thread->cpuTicks + Uncharged();
+	thread->throttled = FALSE;
+	if (!rtReady->IsEmpty())
+	    thread->Yield();		// in case there's an earlier deadline
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ReleaseJobs
+// 	Called from the timer interrupt handler.  Make ready every
+//	periodic thread whose next period has begun, with its deadline at
+//	the end of that period and a fresh budget.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ReleaseJobs()
+{
+    Thread *thread;
+    int release;
+
+    while ((thread = (Thread *)rtSleeping->SortedRemove(&release)) != NULL) {
+	if (release > stats->totalTicks) {	// not yet: put it back
+	    rtSleeping->SortedInsert(&thread->queueLink, release);
+	    break;
+	}
+	thread->deadline = release + thread->period;
+	thread->jobStart = thread->cpuTicks;
+	thread->throttled = FALSE;
+	ReadyToRun(thread);
+    }
+}
+#endif
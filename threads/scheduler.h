@@ -11,15 +11,64 @@
 
 #include "copyright.h"
 #include "list.h"
+#ifdef CHANGED
+#include "queue.h"
+#endif
 #include "thread.h"
 
+#ifdef CHANGED
+// How the next thread to run is chosen; picked at startup with -sched.
+enum SchedulerPolicy {
+    FifoPolicy,			// one ready list, round robin on the timer
+    MLFQPolicy,			// multilevel feedback queue
+    PriorityPolicy,		// strict priority, with inheritance
+    StridePolicy		// proportional share, by tickets
+};
+
+// Multilevel feedback queue parameters.  A thread starts at level 0
+// (highest priority) and drops a level each time it uses up its
+// quantum there; the quantum doubles at each level.  Threads that
+// block before using their quantum move back up a level, and every
+// MLFQBoostTicks everything goes back to level 0 so that long running
+// threads aren't starved.
+#define MLFQLevels	3
+#define MLFQQuantum(level)	(1 << (level))	// in timer interrupts
+#define MLFQBoostTicks	(50 * TimerTicks)
+
+// Compare stride scheduler pass values.  They are allowed to wrap around,
+// as long as no two are more than 2^31 apart.
+#define PassBefore(a, b)	((int)((a) - (b)) < 0)
+
+// Real-time threads (see Thread::SetRealTime) run ahead of everything
+// else, whatever the policy, earliest deadline first.  EDF can meet every
+// deadline as long as the threads' budgets add up to no more than their
+// periods allow; utilizations are kept in thousandths.
+#define EDFMaxUtilization	1000
+
+// The CPU used by each thread, kept after the thread is gone so that the
+// stride report can compare its share with its tickets.
+#define MaxAccounts	64
+#define AccountNameLen	16
+
+class CpuAccount {
+  public:
+    char name[AccountNameLen];
+    int tickets;		// as of the last time the thread ran
+    int ticks;			// CPU time used
+};
+#endif
+
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
 
 class Scheduler {
   public:
+#ifdef CHANGED
+    Scheduler(SchedulerPolicy policy = FifoPolicy, bool report = FALSE);
+#else
     Scheduler();			// Initialize list of ready threads 
+#endif
     ~Scheduler();			// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
@@ -27,10 +76,85 @@ class Scheduler {
 					// list, if any, and return thread.
     void Run(Thread* nextThread);	// Cause nextThread to start running
     void Print();			// Print contents of ready list
+
+#ifdef CHANGED
+    bool TimerTick();			// Called from the timer interrupt;
+					// TRUE if the running thread should
+					// give up the CPU
+    void ThreadFinished(Thread* thread);// Account for a thread that is done
+    void Report();			// Print response and turnaround
+					// times (and CPU shares under
+					// stride), at halt, if asked for
+    bool isReporting() { return report; }
+    SchedulerPolicy getPolicy() { return policy; }
+
+    void SetPriority(Thread* thread, int priority);
+					// Change the priority the thread is
+					// scheduled at, moving it between
+					// ready queues if need be
+
+    bool AdmitRealTime(Thread* thread, int period, int budget);
+					// Admission test for a periodic thread
+    void EndOfJob(Thread* thread);	// A periodic thread finished its job
+    void ReleaseJobs();			// Called from the timer interrupt:
+					// wake periodic threads whose next
+					// period has begun
+    bool RealTimeWaiting() { return !rtSleeping->IsEmpty(); }
+#endif
     
   private:
+#ifdef CHANGED
+    Queue *readyList;  		// queue of threads that are ready to run,
+				// but not running
+#else
     List *readyList;  		// queue of threads that are ready to run,
 				// but not running
+#endif
+#ifdef CHANGED
+    SchedulerPolicy policy;
+    Queue *levels[MLFQLevels];	// MLFQ ready queues, highest first
+    int nextBoost;		// when to next move everyone to level 0
+
+    Queue *priorityQueues[NumPriorities];	// ready threads by priority
+    unsigned int readyMask;	// bit p is set if queue p is non-empty,
+				// so the most urgent is found in O(1)
+    int HighestReady();		// highest non-empty queue, or -1
+    void WakeIdleCpu(Thread* thread);	// give the thread to an idle CPU
+    Thread *StealWork();	// from another CPU's run queue (under FIFO
+				// with more than one CPU, each has its own)
+
+    bool report;		// print a line per thread as it finishes
+    int threadsFinished;	// and totals for the summary
+    int totalResponse;
+    int totalTurnaround;
+
+    void Boost();		// everyone back to level 0
+
+    Thread **strideHeap;	// ready threads, a min-heap on pass
+    int heapSize;
+    int heapCapacity;
+    unsigned int globalPass;	// pass of the last thread picked; threads
+				// that were away start from here
+    void HeapInsert(Thread* thread);
+    Thread *HeapRemoveMin();
+
+    int lastCharge;		// when the running thread was last charged
+    int lastIdle;		// and stats->idleTicks then
+    void Charge(Thread* thread);// charge the running thread for its ticks
+
+    CpuAccount accounts[MaxAccounts];
+    int numAccounts;
+    void StrideReport();
+    int Uncharged();		// ticks the running thread has used
+				// since it was last charged
+
+    Queue *rtReady;		// ready real-time threads, by deadline
+    Queue *rtSleeping;		// waiting for their next release, by time
+    int rtUtilization;		// of the admitted threads, in thousandths
+    int rtJobs;			// totals for the report
+    int rtMisses;
+    int rtOverruns;
+#endif
 };
 
 #endif // SCHEDULER_H
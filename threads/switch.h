@@ -5,7 +5,8 @@
  *	the registers to be saved, how to set up an initial
  *	call frame, etc, are all specific to a processor architecture.
  *
- * 	This file currently supports the DEC MIPS and SUN SPARC architectures.
+ * 	This file currently supports the DEC MIPS, SUN SPARC, HP PA-RISC,
+ *	Intel 386 and x86-64 architectures.
  */
 
 /*
@@ -152,4 +153,39 @@
 #define StartupPC       %ecx
 #endif
 
+#ifdef HOST_x86_64
+
+/* The System V AMD64 ABI has the callee save %rbx, %rbp and %r12-%r15,
+ * so those (and the stack pointer) are all SWITCH has to keep; the
+ * compiler saves anything else it cares about around the call.  The
+ * return address is left on the thread's stack, rather than copied into
+ * the Thread object as on the 386.
+ *
+ * The offsets of the registers from the beginning of the thread object.
+ * Each slot is 8 bytes (stackTop, then machineState[], both PtrInts).
+ */
+#define _RSP	0
+#define _RBX	8
+#define _RBP	16
+#define _R12	24
+#define _R13	32
+#define _R14	40
+#define _R15	48
+#define _PC	56	/* unused by SWITCH; ThreadRoot is on the stack */
+
+/* These definitions are used in Thread::AllocateStack(). */
+#define PCState		(_PC/8-1)
+#define FPState		(_RBP/8-1)
+#define InitialPCState	(_R12/8-1)
+#define InitialArgState	(_R13/8-1)
+#define WhenDonePCState	(_R14/8-1)
+#define StartupPCState	(_R15/8-1)
+
+#define InitialPC	%r12
+#define InitialArg	%r13
+#define WhenDonePC	%r14
+#define StartupPC	%r15
+
+#endif 	// HOST_x86_64
+
 #endif // SWITCH_H
@@ -10,6 +10,7 @@
  *	    SUN SPARC
  *	    HP PA-RISC
  *	    Intel 386
+ *	    x86-64
  *
  * We define two routines for each architecture:
  *
@@ -339,3 +340,68 @@ SWITCH:
         ret
 
 #endif
+
+#ifdef HOST_x86_64
+
+        .text
+        .align  16
+
+        .globl  ThreadRoot
+
+/* void ThreadRoot( void )
+**
+** expects the following registers to be initialized:
+**      r15     points to startup function (interrupt enable)
+**      r13     contains inital argument to thread function
+**      r12     points to thread function
+**      r14     point to Thread::Finish()
+**
+** The ABI wants the stack 16-byte aligned at each call, so align it
+** here rather than rely on how the stack was set up.
+*/
+ThreadRoot:
+        pushq   %rbp
+        movq    %rsp,%rbp
+        andq    $-16,%rsp
+        call    *StartupPC
+        movq    InitialArg,%rdi
+        call    *InitialPC
+        call    *WhenDonePC
+
+        # NOT REACHED
+        movq    %rbp,%rsp
+        popq    %rbp
+        ret
+
+
+
+/* void SWITCH( thread *t1, thread *t2 )
+**
+** on entry, t1 is in rdi, t2 in rsi, and the return address is on
+** top of the stack.  We only save the callee-saved registers: the
+** caller of SWITCH has already saved any others it needs.  Saving the
+** stack pointer saves the return address with it; the "ret" at the end
+** returns into t2, at the point it called SWITCH (or into ThreadRoot,
+** for a new thread).
+*/
+        .globl  SWITCH
+SWITCH:
+        movq    %rsp,_RSP(%rdi)         # save t1's registers
+        movq    %rbx,_RBX(%rdi)
+        movq    %rbp,_RBP(%rdi)
+        movq    %r12,_R12(%rdi)
+        movq    %r13,_R13(%rdi)
+        movq    %r14,_R14(%rdi)
+        movq    %r15,_R15(%rdi)
+
+        movq    _RSP(%rsi),%rsp         # and load t2's
+        movq    _RBX(%rsi),%rbx
+        movq    _RBP(%rsi),%rbp
+        movq    _R12(%rsi),%r12
+        movq    _R13(%rsi),%r13
+        movq    _R14(%rsi),%r14
+        movq    _R15(%rsi),%r15
+
+        ret
+
+#endif // HOST_x86_64
@@ -25,6 +25,160 @@
 #include "synch.h"
 #include "system.h"
 
+#ifdef CHANGED
+static SyncProfile *profiles = NULL;	// every profile, live or retired
+
+// The counts for one kind and name, for SyncProfile::Report.
+struct SyncTotal {
+    char *kind;
+    char *name;
+    int acquires, contended, waitTicks, maxWait, holdTicks;
+};
+
+//----------------------------------------------------------------------
+// SyncProfile::SyncProfile
+// 	Start counting for a new synchronization object, and put the
+//	profile on the list for the report.
+//
+//	"kindName" is what sort of object it is.
+//	"debugName" is the object's name, which it keeps until it goes.
+//----------------------------------------------------------------------
+
+SyncProfile::SyncProfile(char *kindName, char *debugName)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    kind = kindName;
+    name = debugName;
+    acquires = contended = 0;
+    waitTicks = maxWait = holdTicks = 0;
+    retired = FALSE;
+
+    prev = NULL;
+    next = profiles;
+    if (profiles != NULL)
+	profiles->prev = this;
+    profiles = this;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SyncProfile::~SyncProfile
+// 	The object is being deleted.  If it was ever used, add its counts
+//	to the retired profile for objects of the same kind and name --
+//	files, pipes and processes each have locks of their own, all
+//	named alike -- or, if there isn't one yet, make a copy of this
+//	profile into one.
+//----------------------------------------------------------------------
+
+SyncProfile::~SyncProfile()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    SyncProfile *p;
+
+    if (prev == NULL)
+	profiles = next;
+    else
+	prev->next = next;
+    if (next != NULL)
+	next->prev = prev;
+
+    if (retired)
+	delete [] name;
+    else if (acquires > 0) {
+	for (p = profiles; p != NULL; p = p->next)
+	    if (p->retired && !strcmp(p->kind, kind) && !strcmp(p->name, name))
+		break;
+	if (p == NULL) {
+	    char *copy = new char[strlen(name) + 1];
+	    strcpy(copy, name);
+	    p = new SyncProfile(kind, copy);
+	    p->retired = TRUE;
+	}
+	p->acquires += acquires;
+	p->contended += contended;
+	p->waitTicks += waitTicks;
+	p->maxWait = max(p->maxWait, maxWait);
+	p->holdTicks += holdTicks;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SyncProfile::Waited
+// 	Count a thread that had to wait, from "since" until now.
+//----------------------------------------------------------------------
+
+void
+SyncProfile::Waited(int since)
+{
+    int ticks = stats->totalTicks - since;
+
+    contended++;
+    waitTicks += ticks;
+    maxWait = max(maxWait, ticks);
+}
+
+//----------------------------------------------------------------------
+// SyncProfile::Report
+// 	Print the profiles, one line per kind and name, in decreasing
+//	order of total wait.  Objects that were never used are left out.
+//----------------------------------------------------------------------
+
+void
+SyncProfile::Report()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    SyncProfile *p;
+    SyncTotal *totals, *t;
+    int n = 0, i;
+
+    for (p = profiles; p != NULL; p = p->next)
+	n++;
+    totals = new SyncTotal[max(n, 1)];
+    n = 0;
+    for (p = profiles; p != NULL; p = p->next) {
+	if (p->acquires == 0)
+	    continue;
+	for (i = 0; i < n; i++)
+	    if (!strcmp(totals[i].kind, p->kind)
+			&& !strcmp(totals[i].name, p->name))
+		break;
+	t = &totals[i];
+	if (i == n) {
+	    t->kind = p->kind;
+	    t->name = p->name;
+	    t->acquires = t->contended = 0;
+	    t->waitTicks = t->maxWait = t->holdTicks = 0;
+	    n++;
+	}
+	t->acquires += p->acquires;
+	t->contended += p->contended;
+	t->waitTicks += p->waitTicks;
+	t->maxWait = max(t->maxWait, p->maxWait);
+	t->holdTicks += p->holdTicks;
+    }
+
+    List *sorted = new List;
+    for (i = 0; i < n; i++)
+	sorted->SortedInsert((void *)&totals[i], -totals[i].waitTicks);
+    printf("\nContention, by total wait:\n");
+    printf("%-10s %-30s %9s %9s %10s %8s %10s\n", "kind", "name",
+	   "acquires", "contended", "wait", "max wait", "held");
+    while ((t = (SyncTotal *)sorted->Remove()) != NULL) {
+	printf("%-10s %-30s %9d %9d %10d %8d ", t->kind, t->name,
+	       t->acquires, t->contended, t->waitTicks, t->maxWait);
+	if (!strcmp(t->kind, "lock") || !strcmp(t->kind, "rwlock"))
+	    printf("%10d\n", t->holdTicks);
+	else
+	    printf("%10s\n", "-");
+    }
+    delete sorted;
+    delete [] totals;
+    (void) interrupt->SetLevel(oldLevel);
+}
+#endif
+
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
 // 	Initialize a semaphore, so that it can be used for synchronization.
@@ -33,11 +187,20 @@
 //	"initialValue" is the initial value of the semaphore.
 //----------------------------------------------------------------------
 
+#ifdef CHANGED
+Semaphore::Semaphore(char* debugName, int initialValue, bool profiled)
+{
+    name = debugName;
+    value = initialValue;
+    queue = new Queue;
+    profile = profiled ? new SyncProfile("semaphore", debugName) : NULL;
+#else
 Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
     queue = new List;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -49,8 +212,174 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 Semaphore::~Semaphore()
 {
     delete queue;
+#ifdef CHANGED
+    delete profile;
+#endif
+}
+
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// NextWaiter, RemoveNextWaiter
+// 	Find the thread to wake next on a queue of waiters, and take it
+//	off the queue.  Under the priority policy that is the most urgent
+//	one (the longest waiting of those, if there are several);
+//	otherwise the queue is FIFO.
+//----------------------------------------------------------------------
+
+static Thread *
+NextWaiter(Queue *queue)
+{
+    QueueLink *link = queue->Head();
+    Thread *chosen = (link != NULL) ? (Thread *)link->item : NULL;
+
+    if (scheduler->getPolicy() != PriorityPolicy)
+	return chosen;
+    for (; link != NULL; link = link->next) {
+	Thread *thread = (Thread *)link->item;
+	if (thread->priority > chosen->priority)
+	    chosen = thread;
+    }
+    return chosen;
+}
+
+static Thread *
+RemoveNextWaiter(Queue *queue)
+{
+    Thread *chosen = NextWaiter(queue);
+
+    if (chosen != NULL)
+	queue->Unlink(&chosen->queueLink);
+    return chosen;
+}
+
+//----------------------------------------------------------------------
+// Semaphore::WaiterPriority
+// 	Return the priority of the most urgent thread waiting in P, or -1.
+//	Interrupts must be off.
+//----------------------------------------------------------------------
+
+int
+Semaphore::WaiterPriority()
+{
+    int p = -1;
+
+    for (QueueLink *link = queue->Head(); link != NULL; link = link->next)
+	p = max(p, ((Thread *)link->item)->priority);
+    return p;
+}
+
+//----------------------------------------------------------------------
+// Semaphore::Requeue
+// 	Put a blocked thread on our queue, just as if it had called P and
+//	had to wait: the next V makes it ready.  For Lock::Morph, which
+//	moves threads signalled on a condition over to the lock.
+//	Interrupts must be off.
+//----------------------------------------------------------------------
+
+void
+Semaphore::Requeue(Thread *thread)
+{
+    ASSERT(thread->getStatus() == BLOCKED);
+    thread->queueLink.key = 1;		// what a Lock's P asks for
+    queue->Append(&thread->queueLink);
 }
 
+//----------------------------------------------------------------------
+// Semaphore::P
+// 	Wait until semaphore value >= n, then take n from it, all at
+//	once.  Checking the value and decrementing must be done
+//	atomically, so we need to disable interrupts before checking the
+//	value.  How much we need goes in our queue link's key, for V.
+//
+//	Note that Thread::Sleep assumes that interrupts are disabled
+//	when it is called.
+//----------------------------------------------------------------------
+
+void
+Semaphore::P(int n)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    int waitStart = (value < n) ? stats->totalTicks : -1;
+
+    ASSERT(n > 0);
+    while (value < n) { 			// semaphore not available
+	currentThread->queueLink.key = n;
+	queue->Append(&currentThread->queueLink);	// so go to sleep
+	currentThread->Sleep();
+    } 
+    if (profile != NULL) {
+	profile->acquires++;
+	if (waitStart >= 0)
+	    profile->Waited(waitStart);
+    }
+    value -= n; 				// semaphore available, 
+						// consume its value
+    
+    (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
+}
+
+//----------------------------------------------------------------------
+// Semaphore::TryP
+// 	Take n from the semaphore value if it is at least n, without
+//	waiting.
+//
+// Returns:
+//	TRUE if we took them.
+//----------------------------------------------------------------------
+
+bool
+Semaphore::TryP(int n)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool taken = (value >= n);
+
+    ASSERT(n > 0);
+    if (taken) {
+	value -= n;
+	if (profile != NULL)
+	    profile->acquires++;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return taken;
+}
+
+//----------------------------------------------------------------------
+// Semaphore::V
+// 	Add n to the semaphore value, and in the same pass wake up as many
+//	waiters as that will satisfy.  As with P(), this operation must
+//	be atomic, so we need to disable interrupts.
+//	Scheduler::ReadyToRun() assumes that threads are disabled when it
+//	is called.
+//
+//	Waiters are woken in the order RemoveNextWaiter would take them,
+//	each if what is left covers what it asked for, stopping at the
+//	first that it doesn't, so they are at least woken in order.
+//	This is not fair to big requests: a woken waiter is not given its
+//	share, only the chance to take it when it runs, and a thread
+//	arriving in P meanwhile may take it first.  Handing the value
+//	over would make a Lock, which is built on a semaphore, convoy
+//	(see Lock::Morph).
+//----------------------------------------------------------------------
+
+void
+Semaphore::V(int n)
+{
+    Thread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int left;
+
+    ASSERT(n > 0);
+    value += n;
+    for (left = value; (thread = NextWaiter(queue)) != NULL; ) {
+	if (thread->queueLink.key > left)
+	    break;
+	left -= thread->queueLink.key;
+	queue->Unlink(&thread->queueLink);
+	scheduler->ReadyToRun(thread);	// it takes its share when it runs
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+#else
 //----------------------------------------------------------------------
 // Semaphore::P
 // 	Wait until semaphore value > 0, then decrement.  Checking the
@@ -96,6 +425,7 @@ Semaphore::V()
     value++;
     (void) interrupt->SetLevel(oldLevel);
 }
+#endif
 
 
 
@@ -105,44 +435,104 @@ Semaphore::V()
 
 // A lock wraps around a semaphore.
 Lock::Lock(char* debugName) 
+  : heldLink(this)
 {
   name = debugName;
   lockOwner = NULL;
-  sem = new Semaphore(debugName, 1);
+  sem = new Semaphore(debugName, 1, FALSE);	// we do the counting
+  profile = new SyncProfile("lock", debugName);
+  acquiredAt = 0;
 }
 
 
 Lock::~Lock() 
 {
   delete sem;
+  delete profile;
 }
 
 
 // Current thread attempts to acquire the lock.
 //
 // Thread will sleep if another thread has the lock.
+//
+// Under the priority policy, a thread that has to wait lends its
+// priority to the holder, and on down the chain if the holder is itself
+// waiting for a lock, so that a low priority holder can't be kept off
+// the CPU by medium priority threads while urgent work waits on it.
 void Lock::Acquire() 
 {
   IntStatus oldLevel = interrupt->SetLevel(IntOff);
   DEBUG('t', "Thread \"%s\" is acquiring lock.\n", currentThread->getName());
+  bool inherit = (scheduler->getPolicy() == PriorityPolicy);
+  if (inherit) {
+    Thread *holder = lockOwner;
+    while (holder != NULL && holder->priority < currentThread->priority) {
+      DEBUG('t', "Thread \"%s\" lends priority %d to \"%s\"\n",
+	    currentThread->getName(), currentThread->priority, holder->getName());
+      scheduler->SetPriority(holder, currentThread->priority);
+      holder = (holder->waitingOn != NULL) ? holder->waitingOn->getOwner() : NULL;
+    }
+    currentThread->waitingOn = this;
+  }
+  int waitStart = stats->totalTicks;
+  bool busy = (lockOwner != NULL);
   sem->P();
   lockOwner = currentThread;
+  acquiredAt = stats->totalTicks;
+  profile->acquires++;
+  if (busy)
+    profile->Waited(waitStart);
+  if (inherit) {
+    currentThread->waitingOn = NULL;
+    currentThread->locksHeld->Append(&heldLink);
+    currentThread->UpdatePriority();	// take on any remaining waiters'
+  }
   (void) interrupt->SetLevel(oldLevel);
 }
 
 
 // Current thread releases the lock, and wakes another thread blocked on the
-// lock.
+// lock.  Any priority inherited through this lock is given back first,
+// so that the waiter we wake can preempt us.
 void Lock::Release() 
 {
   IntStatus oldLevel = interrupt->SetLevel(IntOff);
   DEBUG('t', "Thread \"%s\" is RELEASING lock.\n", currentThread->getName());
-  sem->V();
+  if (scheduler->getPolicy() == PriorityPolicy && lockOwner != NULL) {
+    lockOwner->locksHeld->Unlink(&heldLink);
+    lockOwner->UpdatePriority();
+  }
+  if (lockOwner != NULL)
+    profile->holdTicks += stats->totalTicks - acquiredAt;
   lockOwner = NULL;
+  sem->V();
   (void) interrupt->SetLevel(oldLevel);
 }
 
 
+// Put a thread, just taken off a condition's queue, in line for the
+// lock, which the current thread must hold.  It stays blocked until a
+// Release wakes it, and then acquires the lock as any waiter would:
+// waking it now would only have it find the lock held.
+//
+// The lock isn't handed over directly, as that would make the
+// signaller wait for the thread it signalled whenever it wanted the
+// lock back -- a convoy, under the FIFO scheduler on every iteration
+// of a producer's loop.  Under the priority policy the thread lends the
+// holder its priority, as a waiter in Acquire does.
+void Lock::Morph(Thread *thread)
+{
+  ASSERT(interrupt->getLevel() == IntOff && isHeldByCurrentThread());
+  sem->Requeue(thread);
+  stats->numMorphedWaits++;
+  if (scheduler->getPolicy() == PriorityPolicy) {
+    thread->waitingOn = this;
+    lockOwner->UpdatePriority();
+  }
+}
+
+
 bool Lock::isHeldByCurrentThread()
 {
   return (lockOwner == currentThread);
@@ -174,13 +564,15 @@ Thread* Lock::getOwner()
 Condition::Condition(char* debugName) 
 {
   name = debugName;
-  queue = new List;
+  queue = new Queue;
+  profile = new SyncProfile("condition", debugName);
 }
 
 
 Condition::~Condition() 
 {
   delete queue;
+  delete profile;
 }
 
 
@@ -200,10 +592,12 @@ void Condition::Wait(Lock* conditionLock)
   Thread* lockOwner = conditionLock->getOwner();
   if (lockOwner != NULL) {
     ASSERT(lockOwner == currentThread);
-    queue->Append((void *)currentThread);
+    queue->SortedInsert(&currentThread->queueLink, stats->totalTicks);
+					// (keyed by when we started waiting)
 
     conditionLock->Release();
     DEBUG('t', "Thread \"%s\" is BLOCKED on condition \"%s\"\n", currentThread->getName(), name);
+    profile->acquires++;
     currentThread->Sleep();
     DEBUG('t', "Thread \"%s\" has woken and is about to get lock.\n", currentThread->getName());
     conditionLock->Acquire();
@@ -212,6 +606,19 @@ void Condition::Wait(Lock* conditionLock)
 }
 
 
+// Wake a thread taken off the queue: count its wait, then move it on
+// to the lock's queue if we hold the lock (see synch.h), or else make
+// it ready to run, to acquire the lock for itself.
+void Condition::Wake(Thread *thread, Lock *conditionLock)
+{
+  profile->Waited(thread->queueLink.key);
+  if (conditionLock != NULL && conditionLock->isHeldByCurrentThread())
+    conditionLock->Morph(thread);
+  else
+    scheduler->ReadyToRun(thread);
+}
+
+
 // Signals on the condition variable.
 //
 // This will wake a thread blocked on the condition variable.
@@ -223,9 +630,9 @@ void Condition::Signal(Lock* conditionLock)
   IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
   if (queue->IsEmpty() == false) {
-    thread = (Thread *)queue->Remove();
+    thread = RemoveNextWaiter(queue);
     DEBUG('t', "- woke up thread \"%s\"\n", thread->getName());
-    if (thread != NULL) scheduler->ReadyToRun(thread);
+    if (thread != NULL) Wake(thread, conditionLock);
   }
   (void) interrupt->SetLevel(oldLevel);
 }
@@ -237,10 +644,9 @@ void Condition::Broadcast(Lock* conditionLock)
   Thread *thread;
   IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-  // TODO: check if the current thread holds the lock
   while (queue->IsEmpty() == false) {
     thread = (Thread *)queue->Remove();
-    if (thread != NULL) scheduler->ReadyToRun(thread);
+    if (thread != NULL) Wake(thread, conditionLock);
   }
   (void) interrupt->SetLevel(oldLevel);
 }
@@ -255,73 +661,130 @@ void Condition::Broadcast(Lock* conditionLock)
 // - If writers are writing then readers are blocked. Other
 //   readers can pass through.
 //
-// Adapted from: http://grommit.com/~ranga/school/cs140/
-ReadWriteLock::ReadWriteLock()
+// Rather than one condition that every waiter sleeps on, and a
+// Broadcast on every unlock, readers and writers each have a queue,
+// and whoever unlocks hands the lock over to exactly the threads that
+// can have it: the next writer, or all of the waiting readers.  Those
+// threads find the lock already theirs when they wake.  Atomicity is by
+// disabling interrupts, as for semaphores.
+ReadWriteLock::ReadWriteLock(char* debugName, RWPolicy rwPolicy)
 {
-    rwlock = new Lock("rwlock") ;
-    rwcondition = new Condition("rwCondition") ;
+    name = debugName;
+    policy = rwPolicy;
+    readers = new Queue;
+    writers = new Queue;
     readerCount = 0;
     lockStatus = FREE;
     writeOwner = 0;
+    profile = new SyncProfile("rwlock", debugName);
+    writeStart = 0;
 }
 
 ReadWriteLock::~ReadWriteLock()
 {
     ASSERT(readerCount == 0);
     ASSERT(lockStatus == FREE);
-    delete rwlock ;
-    delete rwcondition ;
+    ASSERT(readers->IsEmpty() && writers->IsEmpty());
+    delete readers;
+    delete writers;
+    delete profile;
+}
+
+// Hand the lock to every reader waiting for it, as a batch.
+void ReadWriteLock::AdmitReaders()
+{
+    Thread *thread;
+
+    lockStatus = READ;
+    while ((thread = (Thread *)readers->Remove()) != NULL) {
+        readerCount++;
+        scheduler->ReadyToRun(thread);
+    }
+}
+
+// Hand the lock to the writer that is to go next.
+void ReadWriteLock::HandToWriter()
+{
+    Thread *thread = RemoveNextWaiter(writers);
+
+    lockStatus = WRITE;
+    writeOwner = thread;
+    scheduler->ReadyToRun(thread);
 }
 
 void ReadWriteLock::ReadLock()
 {
-    rwlock->Acquire();
-    while (lockStatus == WRITE)
-        rwcondition->Wait(rwlock);
-    ASSERT(readerCount >= 0);
-    if (lockStatus == FREE) {
-        ASSERT(readerCount == 0);
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    profile->acquires++;
+    if (lockStatus == WRITE || !writers->IsEmpty()) {
+        int waitStart = stats->totalTicks;
+        readers->Append(&currentThread->queueLink);
+        currentThread->Sleep();		// AdmitReaders counts us in
+        ASSERT(lockStatus == READ);
+        profile->Waited(waitStart);
+    } else {
         lockStatus = READ;
+        readerCount++;
     }
-    readerCount++;
-    rwlock->Release();
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 void ReadWriteLock::ReadUnlock()
 {
-    rwlock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
     ASSERT(lockStatus == READ);
     readerCount--;
     ASSERT(readerCount >= 0);
     if (readerCount == 0) {
         lockStatus = FREE;
-        rwcondition->Broadcast(rwlock);
+        if (!writers->IsEmpty())
+            HandToWriter();
+        else if (!readers->IsEmpty())
+            AdmitReaders();
     }
-    rwlock->Release();
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 void ReadWriteLock::WriteLock()
 {
-    rwlock->Acquire();
-    while (lockStatus != FREE)
-        rwcondition->Wait(rwlock);
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    profile->acquires++;
+    if (lockStatus != FREE) {
+        int waitStart = stats->totalTicks;
+        writers->Append(&currentThread->queueLink);
+        currentThread->Sleep();		// HandToWriter made us the owner
+        ASSERT(writeOwner == currentThread);
+        profile->Waited(waitStart);
+    } else {
+        ASSERT(writeOwner == 0);
+        writeOwner = currentThread;
+        lockStatus = WRITE;
+    }
     ASSERT(readerCount == 0);
-    ASSERT(writeOwner == 0);
-    writeOwner = currentThread;
-    lockStatus = WRITE;
-    rwlock->Release();
+    writeStart = stats->totalTicks;
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 void ReadWriteLock::WriteUnlock()
 {
-    rwlock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
     ASSERT(lockStatus == WRITE);
     ASSERT(readerCount == 0);
     ASSERT(writeOwner == currentThread);
+    profile->holdTicks += stats->totalTicks - writeStart;
     lockStatus = FREE;
     writeOwner = 0;
-    rwcondition->Broadcast(rwlock);
-    rwlock->Release();
+    if (policy == PhaseFair && !readers->IsEmpty())
+        AdmitReaders();
+    else if (!writers->IsEmpty())
+        HandToWriter();
+    else if (!readers->IsEmpty())
+        AdmitReaders();
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 
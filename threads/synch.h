@@ -20,6 +20,51 @@
 #include "copyright.h"
 #include "thread.h"
 #include "list.h"
+#ifdef CHANGED
+#include "queue.h"
+
+// The following class counts how often a synchronization object made
+// threads wait, and for how long, in simulated ticks.  Every Lock,
+// Semaphore and Condition keeps one; "nachos -lp" prints them all at
+// Interrupt::Halt, added up by name, so that the locks that serialize
+// a workload stand out.
+//
+// What counts as an acquisition depends on the kind of object: for a
+// Lock it is Acquire, and the time until the matching Release is the
+// hold time; for a Semaphore it is P; for a Condition it is Wait, which
+// always waits, for as long as it takes to be signalled.  A
+// ReadWriteLock counts both ReadLock and WriteLock, and the time held
+// for writing.
+//
+// The internal data structures are left public, as with
+// PendingInterrupt, for the objects that keep them up to date.
+
+class SyncProfile {
+  public:
+    SyncProfile(char *kindName, char *debugName);
+				// start counting, on the list of profiles
+    ~SyncProfile();		// fold our counts into the totals for our
+				// name, for the report
+
+    void Waited(int since);	// a thread waited from "since" until now
+
+    static void Report();	// print every profile, most waited on first
+
+    char *kind;			// "lock", "rwlock", "semaphore" or
+				// "condition"
+    char *name;			// the object's debugName
+    int acquires;		// acquisitions
+    int contended;		// ... that had to wait
+    int waitTicks;		// total ticks spent waiting
+    int maxWait;		// longest single wait
+    int holdTicks;		// total ticks held (locks only)
+
+  private:
+    SyncProfile *next;		// all profiles are on a doubly linked list
+    SyncProfile *prev;
+    bool retired;		// the object is gone; we own "name"
+};
+#endif
 
 
 // The following class defines a "semaphore" whose value is a non-negative
@@ -28,6 +73,11 @@
 //	P() -- waits until value > 0, then decrement
 //
 //	V() -- increment, waking up a thread waiting in P() if necessary
+//
+// P(n) and V(n) do the same n at a time, atomically, and TryP(n) is P(n)
+// if it wouldn't have to wait -- so that a pool of resources can be
+// taken from or given back to in bulk, without a trip through the
+// semaphore, and perhaps the scheduler, for every unit.
 // 
 // Note that the interface does *not* allow a thread to read the value of 
 // the semaphore directly -- even if you did read the value, the
@@ -39,17 +89,40 @@
 
 class Semaphore {
   public:
+#ifdef CHANGED
+    Semaphore(char* debugName, int initialValue, bool profiled = TRUE);
+					// set initial value; a Lock's
+					// own semaphore isn't profiled
+#else
     Semaphore(char* debugName, int initialValue);	// set initial value
+#endif
     ~Semaphore();   					// de-allocate semaphore
     char* getName() { return name;}			// debugging assist
     
+#ifdef CHANGED
+    void P() { P(1); }	 // these are the only operations on a semaphore
+    void V() { V(1); }	 // they are all *atomic*
+    void P(int n);	 // take "n" at once, waiting until there are
+    void V(int n);	 // give back "n", waking whoever they satisfy
+    bool TryP(int n);	 // take "n" if there are that many; else FALSE
+#else
     void P();	 // these are the only operations on a semaphore
     void V();	 // they are both *atomic*
+#endif
+#ifdef CHANGED
+    int WaiterPriority();	// most urgent thread waiting, or -1
+    void Requeue(Thread *thread);	// as if "thread" were waiting in P
+#endif
     
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
+#ifdef CHANGED
+    Queue *queue;      // threads waiting in P() for the value to be > 0
+    SyncProfile *profile;	// contention counts, or NULL
+#else
     List *queue;       // threads waiting in P() for the value to be > 0
+#endif
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -77,11 +150,23 @@ class Lock {
 					// holds this lock.  Useful for
 					// checking in Release, and in
 					// Condition variable ops below.
+#ifdef CHANGED
+    int WaiterPriority() { return sem->WaiterPriority(); }
+					// most urgent thread waiting in
+					// Acquire, or -1
+    void Morph(Thread *thread);		// put a thread signalled on a
+					// condition in line for the lock
+#endif
 
   private:
     char* name;				// for debugging
     Thread *lockOwner;                      // remember who acquired the lock
     Semaphore *sem;                    // use semaphore for the actual lock
+#ifdef CHANGED
+    SyncProfile *profile;		// contention counts
+    int acquiredAt;			// when lockOwner got the lock
+    QueueLink heldLink;			// on lockOwner's "locksHeld"
+#endif
 };
 
 // The following class defines a "condition variable".  A condition
@@ -115,6 +200,13 @@ class Lock {
 // The consequence of using Mesa-style semantics is that some other thread
 // can acquire the lock, and change data structures, before the woken
 // thread gets a chance to run.
+//
+// Signal and Broadcast are called holding the lock, so a thread they
+// made ready straight away would, as often as not, run only to find
+// the lock held and block on it again -- after a Broadcast, every one
+// of them would.  Instead, they "morph" the waiters into waiters for
+// the lock (Lock::Morph): each stays blocked until a Release wakes it,
+// as if it had been waiting in Acquire all along.
 
 class Condition {
   public:
@@ -132,27 +224,62 @@ class Condition {
 					// these operations
 
   private:
+    void Wake(Thread *thread, Lock *conditionLock);
+
     char* name;
-    List* queue;  // threads waiting on the condition
+    Queue* queue; // threads waiting on the condition
+    SyncProfile *profile; // contention counts
     Lock* lock;   // debugging aid:  used to check correctness of
                   // arguments to Wait, Signal and Broacast
 };
 
 
+// The following class defines a read/write lock: any number of threads
+// may hold it for reading at once, or one for writing.
+//
+// Readers and writers wait on queues of their own, and the thread
+// releasing the lock hands it straight to the threads it wakes, so no
+// one is woken only to go back to sleep, and no one can slip in ahead
+// of them.  A writer gets the lock to itself; readers are let in as a
+// batch, every reader waiting at the time.
+//
+// A reader has to wait behind a waiting writer even while the lock is
+// held for reading, so that a stream of readers can't starve writers.
+// When a writer releases the lock with both readers and writers
+// waiting, the policy decides who goes next:
+//
+//	WriterPreferring -- the next writer.  Readers wait until there
+//		are no writers; suits locks that are seldom written, where
+//		writes should finish promptly.
+//
+//	PhaseFair -- the readers.  Read and write phases alternate, so
+//		neither side waits for more than one phase of the other.
+
+enum RWPolicy { WriterPreferring, PhaseFair };
+
 class ReadWriteLock {
   public:
-    ReadWriteLock();
+    ReadWriteLock(char* debugName, RWPolicy rwPolicy);
     ~ReadWriteLock();
+    char* getName() { return name; }
     void ReadLock();
     void ReadUnlock();
     void WriteLock();
     void WriteUnlock();
   private:
-    Lock *rwlock;
-    Condition *rwcondition;
+    void AdmitReaders();	// give the lock to every waiting reader
+    void HandToWriter();	// give the lock to the next waiting writer
+
+    char* name;
+    RWPolicy policy;
+    Queue *readers;		// threads waiting in ReadLock
+    Queue *writers;		// threads waiting in WriteLock
     int readerCount;
     Thread *writeOwner; // debug.
     enum status { FREE=0, READ, WRITE, } lockStatus;
+    SyncProfile *profile;	// contention counts; the hold time is for
+				// writers only
+    int writeStart;		// when writeOwner got the lock
 }; 
 
 #endif // SYNCH_H
@@ -19,6 +19,14 @@ Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
 bool nohalt = FALSE;                    // make nachos auto-terminate
+#ifdef CHANGED
+ThreadPool *threadPool;			// finished threads, kept for reuse
+Alarm *alarmClock;			// for kernel threads to sleep on
+int numCpus = 1;			// CPUs in the simulated machine
+Cpu *cpus[MaxCpus];
+Cpu *currentCpu;			// the one being simulated now
+bool lockProfile = FALSE;		// print SyncProfile::Report at Halt
+#endif
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -30,6 +38,8 @@ SynchDisk   *synchDisk;
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+BitMap *memoryMap;	// physical page frames in use
+SharedMemory *sharedMemory;	// named shared segments
 #endif
 
 #ifdef NETWORK
@@ -59,11 +69,37 @@ extern void Cleanup();
 //		whether it needs it or not.
 //----------------------------------------------------------------------
 static void
-TimerInterruptHandler(int dummy)
+TimerInterruptHandler(PtrInt dummy)
 {
+#ifdef CHANGED
+    scheduler->ReleaseJobs();			// even if idle
+    if (interrupt->getStatus() != IdleMode && scheduler->TimerTick()) {
+	interrupt->YieldOnReturn();
+	for (int i = 0; i < numCpus; i++)	// time slice the other CPUs
+	    if (cpus[i] != currentCpu && !cpus[i]->idle)
+		interrupt->SendIPI(cpus[i]);
+    }
+#else
     if (interrupt->getStatus() != IdleMode)
 	interrupt->YieldOnReturn();
+#endif
+}
+
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// StartTimer
+// 	Start the timer device, for the real-time scheduling class, if
+//	the command line didn't.  Ordinary threads are time-sliced from
+//	then on too.
+//----------------------------------------------------------------------
+
+void
+StartTimer()
+{
+    if (timer == NULL)
+	timer = new Timer(TimerInterruptHandler, 0, FALSE);
 }
+#endif
 
 //----------------------------------------------------------------------
 // Initialize
@@ -81,6 +117,11 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+#ifdef CHANGED
+    SchedulerPolicy policy = FifoPolicy;
+    bool schedReport = FALSE;
+    int poolLow = ThreadPoolLow, poolHigh = ThreadPoolHigh;
+#endif
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
@@ -111,6 +152,34 @@ Initialize(int argc, char **argv)
 	} else if (!strcmp(*argv, "-nh")){    
     	    nohalt = TRUE;	   
 	}
+#ifdef CHANGED
+	else if (!strcmp(*argv, "-sched")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "mlfq"))
+		policy = MLFQPolicy;
+	    else if (!strcmp(*(argv + 1), "priority"))
+		policy = PriorityPolicy;
+	    else if (!strcmp(*(argv + 1), "stride"))
+		policy = StridePolicy;
+	    else
+		ASSERT(!strcmp(*(argv + 1), "fifo"));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-sr")) {
+	    schedReport = TRUE;
+	} else if (!strcmp(*argv, "-tp")) {
+	    ASSERT(argc > 2);
+	    poolLow = atoi(*(argv + 1));
+	    poolHigh = atoi(*(argv + 2));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-lp")) {
+	    lockProfile = TRUE;
+	} else if (!strcmp(*argv, "-cpus")) {
+	    ASSERT(argc > 1);
+	    numCpus = atoi(*(argv + 1));
+	    ASSERT(numCpus >= 1 && numCpus <= MaxCpus);
+	    argCount = 2;
+	}
+#endif
 
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
@@ -136,23 +205,42 @@ Initialize(int argc, char **argv)
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
+#ifdef CHANGED
+    scheduler = new Scheduler(policy, schedReport);
+    if (randomYield || policy != FifoPolicy)	// the other policies need
+	timer = new Timer(TimerInterruptHandler, 0, randomYield); // the timer
+#else
     scheduler = new Scheduler();		// initialize the ready queue
     if (randomYield)				// start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
+#endif
 
     threadToBeDestroyed = NULL;
+#ifdef CHANGED
+    threadPool = new ThreadPool(poolLow, poolHigh);
+    alarmClock = new Alarm();
+#endif
 
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a Thread
     // object to save its state. 
     currentThread = new Thread("main");		
     currentThread->setStatus(RUNNING);
+#ifdef CHANGED
+    currentThread->firstRunAt = stats->totalTicks;
+    ASSERT(numCpus == 1 || policy == FifoPolicy || policy == PriorityPolicy);
+    for (int i = 0; i < numCpus; i++)
+	cpus[i] = new Cpu(i);
+    currentCpu = cpus[0];
+#endif
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    memoryMap = new BitMap(NumPhysPages);
+    sharedMemory = new SharedMemory();
 #endif
 
 #ifdef FILESYS
@@ -181,7 +269,9 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    delete sharedMemory;
     delete machine;
+    delete memoryMap;
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -193,6 +283,10 @@ Cleanup()
 #endif
     
     delete timer;
+#ifdef CHANGED
+    delete alarmClock;
+    delete threadPool;
+#endif
     delete scheduler;
     delete interrupt;
     
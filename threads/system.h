@@ -15,6 +15,11 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#ifdef CHANGED
+#include "threadpool.h"
+#include "alarm.h"
+#include "cpu.h"
+#endif
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
@@ -29,10 +34,23 @@ extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
 extern bool nohalt;                             // stop nachos terminating
+#ifdef CHANGED
+extern ThreadPool *threadPool;			// finished threads, for reuse
+extern Alarm *alarmClock;			// sleeping kernel threads
+extern int numCpus;				// simulated CPUs, with -cpus
+extern Cpu *cpus[MaxCpus];
+extern Cpu *currentCpu;				// the CPU currentThread is on
+extern bool lockProfile;			// report contention, with -lp
+extern void StartTimer();			// if it isn't running already
+#endif
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "bitmap.h"
+#include "sharedmemory.h"
 extern Machine* machine;	// user program memory and registers
+extern BitMap* memoryMap;	// physical page frames in use
+extern SharedMemory* sharedMemory;	// named shared segments
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
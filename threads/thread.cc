@@ -33,15 +33,66 @@
 //----------------------------------------------------------------------
 
 Thread::Thread(char* threadName)
+#ifdef CHANGED
+    : queueLink(this)
+#endif
 {
+#ifdef CHANGED
+    stack = NULL;
+    locksHeld = new Queue;
+    Init(threadName);
+#else
     name = threadName;
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
 #ifdef USER_PROGRAM
     space = NULL;
+    process = NULL;
+#endif
+#endif
+}
+
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Thread::Init
+// 	Set up a thread control block as new, apart from the stack and
+//	"locksHeld", which a recycled thread keeps (see threadpool.cc).
+//----------------------------------------------------------------------
+
+void
+Thread::Init(char* threadName)
+{
+    name = threadName;
+    stackTop = NULL;
+    status = JUST_CREATED;
+    level = 0;
+    quantumUsed = 0;
+    createdAt = stats->totalTicks;
+    firstRunAt = -1;
+    basePriority = priority = DefaultPriority;
+    waitingOn = NULL;
+    ASSERT(locksHeld->IsEmpty());
+    ASSERT(queueLink.queue == NULL);
+    tickets = DefaultTickets;
+    stride = StrideOne / DefaultTickets;
+    pass = 0;				// caught up when first made ready
+    cpuTicks = 0;
+    account = -1;
+    usage = CpuUsage();
+    processUsage = NULL;
+    blockedAt = 0;
+    period = budget = 0;
+    deadline = jobStart = 0;
+    throttled = FALSE;
+    jobsDone = deadlineMisses = overruns = 0;
+#ifdef USER_PROGRAM
+    space = NULL;
+    process = NULL;
+    userStackTop = 0;
 #endif
 }
+#endif
 
 //----------------------------------------------------------------------
 // Thread::~Thread
@@ -62,6 +113,9 @@ Thread::~Thread()
     ASSERT(this != currentThread);
     if (stack != NULL)
 	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+#ifdef CHANGED
+    delete locksHeld;
+#endif
     DEBUG('t', "Done, thread gone.\n");
 }
 
@@ -86,10 +140,10 @@ Thread::~Thread()
 //----------------------------------------------------------------------
 
 void 
-Thread::Fork(VoidFunctionPtr func, int arg)
+Thread::Fork(VoidFunctionPtr func, PtrInt arg)
 {
-    DEBUG('t', "Forking thread \"%s\" with func = 0x%x, arg = %d\n",
-	  name, (int) func, arg);
+    DEBUG('t', "Forking thread \"%s\" with func = %p, arg = %ld\n",
+	  name, (void *) func, (long) arg);
     
     StackAllocate(func, arg);
 
@@ -148,6 +202,9 @@ Thread::Finish ()
     ASSERT(this == currentThread);
     
     DEBUG('t', "Finishing thread \"%s\"\n", getName());
+#ifdef CHANGED
+    scheduler->ThreadFinished(this);
+#endif
     
     threadToBeDestroyed = currentThread;
     Sleep();					// invokes SWITCH
@@ -182,6 +239,21 @@ Thread::Yield ()
     
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
     
+#ifdef CHANGED
+    // Other policies rank the threads, as does the real-time class, so
+    // we compete for the CPU with the others and only give it up to one
+    // at least as urgent.
+    if (scheduler->getPolicy() != FifoPolicy || isRealTime()) {
+	scheduler->ReadyToRun(this);
+	nextThread = scheduler->FindNextToRun();
+	if (nextThread != this)
+	    scheduler->Run(nextThread);
+	else
+	    setStatus(RUNNING);
+	(void) interrupt->SetLevel(oldLevel);
+	return;
+    }
+#endif
     nextThread = scheduler->FindNextToRun();
     if (nextThread != NULL) {
 	scheduler->ReadyToRun(this);
@@ -220,12 +292,130 @@ Thread::Sleep ()
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
     status = BLOCKED;
+#ifdef CHANGED
+    blockedAt = stats->totalTicks;	// see Scheduler::ReadyToRun
+    if (numCpus > 1) {			// the CPU has an idle thread, to
+	ASSERT(this != currentCpu->idleThread);	// wait in for others
+	if ((nextThread = scheduler->FindNextToRun()) == NULL)
+	    nextThread = currentCpu->idleThread;
+	scheduler->Run(nextThread);
+	return;
+    }
+#endif
     while ((nextThread = scheduler->FindNextToRun()) == NULL)
 	interrupt->Idle();	// no one to run, wait for an interrupt
         
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Thread::setPriority
+// 	Set the thread's own priority.  It may still run higher while it
+//	holds a lock that a more urgent thread is waiting for.
+//----------------------------------------------------------------------
+
+void
+Thread::setPriority(int p)
+{
+    ASSERT(p >= 0 && p < NumPriorities);
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    basePriority = p;
+    UpdatePriority();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Thread::UpdatePriority
+// 	Priority inheritance: we run at the priority of the most urgent
+//	thread waiting for any lock we hold, if that is above our own.
+//	Called with interrupts disabled, when we set our priority or
+//	release a lock.
+//----------------------------------------------------------------------
+
+void
+Thread::UpdatePriority()
+{
+    int p = basePriority;
+
+    for (QueueLink *link = locksHeld->Head(); link != NULL; link = link->next)
+	p = max(p, ((Lock *)link->item)->WaiterPriority());
+    scheduler->SetPriority(this, p);
+}
+
+//----------------------------------------------------------------------
+// Thread::setTickets
+// 	Change the thread's share of the CPU under stride scheduling.  The
+//	pass isn't touched, so a ready thread keeps its place in the heap;
+//	the new stride applies to the ticks it uses from now on.
+//----------------------------------------------------------------------
+
+void
+Thread::setTickets(int n)
+{
+    ASSERT(n > 0 && n <= MaxTickets);
+    tickets = n;
+    stride = StrideOne / n;
+}
+
+//----------------------------------------------------------------------
+// Thread::Account
+// 	Charge the thread, and the process it belongs to if any, for
+//	ticks spent running user and kernel code, ticks spent blocked,
+//	and giving up the CPU.  Interrupts must be off, or we must be
+//	inside Interrupt::OneTick.
+//----------------------------------------------------------------------
+
+void
+Thread::Account(int user, int system, int blocked, int switched)
+{
+    usage.Add(user, system, blocked, switched);
+    if (processUsage != NULL)
+	processUsage->Add(user, system, blocked, switched);
+}
+
+//----------------------------------------------------------------------
+// Thread::SetRealTime
+// 	Make this a periodic real-time thread, scheduled ahead of all
+//	ordinary threads by earliest deadline first.  Normally called
+//	before Fork; the first job is released at once.  Returns FALSE,
+//	leaving the thread as it was, if the scheduler can't guarantee
+//	the deadlines of this thread and those already admitted.
+//
+//	"period" is in ticks, at least MinPeriod.
+//	"budget" is the most CPU a job will need, in ticks.
+//----------------------------------------------------------------------
+
+bool
+Thread::SetRealTime(int newPeriod, int newBudget)
+{
+    ASSERT(period == 0);
+    if (newPeriod < MinPeriod || newBudget <= 0 || newBudget > newPeriod)
+	return FALSE;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool admitted = scheduler->AdmitRealTime(this, newPeriod, newBudget);
+    (void) interrupt->SetLevel(oldLevel);
+    return admitted;
+}
+
+//----------------------------------------------------------------------
+// Thread::WaitForNextPeriod
+// 	Called by a real-time thread when it has finished its job for
+//	this period.  We sleep until the next job is released (or carry
+//	straight on, if we're already late).
+//----------------------------------------------------------------------
+
+void
+Thread::WaitForNextPeriod()
+{
+    ASSERT(this == currentThread && period > 0);
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    scheduler->EndOfJob(this);
+    (void) interrupt->SetLevel(oldLevel);
+}
+#endif
+
 //----------------------------------------------------------------------
 // ThreadFinish, InterruptEnable, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
@@ -236,7 +426,7 @@ Thread::Sleep ()
 
 static void ThreadFinish()    { currentThread->Finish(); }
 static void InterruptEnable() { interrupt->Enable(); }
-void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
+void ThreadPrint(PtrInt arg){ Thread *t = (Thread *)arg; t->Print(); }
 
 //----------------------------------------------------------------------
 // Thread::StackAllocate
@@ -251,39 +441,63 @@ void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
 //----------------------------------------------------------------------
 
 void
-Thread::StackAllocate (VoidFunctionPtr func, int arg)
+Thread::StackAllocate (VoidFunctionPtr func, PtrInt arg)
 {
+#ifdef CHANGED
+    AllocateStack();			// a recycled thread has one already
+#else
     stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+#endif
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
-    stackTop = stack + 16;	// HP requires 64-byte frame marker
+    stackTop = (PtrInt *) (stack + 16);	// HP requires 64-byte frame marker
     stack[StackSize - 1] = STACK_FENCEPOST;
 #else
     // i386 & MIPS & SPARC stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
-    stackTop = stack + StackSize - 96;
-#else  // HOST_MIPS  || HOST_i386
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
-#ifdef HOST_i386
+    stackTop = (PtrInt *) (stack + StackSize - 96);
+#else  // HOST_MIPS  || HOST_i386 || HOST_x86_64
+    stackTop = (PtrInt *) (stack + StackSize) - 4;	// -4 to be on the safe side!
+#if defined(HOST_i386) || defined(HOST_x86_64)
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
     // return addres used in SWITCH() must be the starting address of
-    // ThreadRoot.
-    *(--stackTop) = (int)ThreadRoot;
+    // ThreadRoot.  (On x86-64 that is all SWITCH uses; it doesn't keep
+    // a separate PC.)
+    *(--stackTop) = (PtrInt)ThreadRoot;
 #endif
 #endif  // HOST_SPARC
     *stack = STACK_FENCEPOST;
 #endif  // HOST_SNAKE
     
-    machineState[PCState] = (int) ThreadRoot;
-    machineState[StartupPCState] = (int) InterruptEnable;
-    machineState[InitialPCState] = (int) func;
+#ifdef CHANGED
+    for (int i = 0; i < MachineStateSize; i++)	// nothing left over from
+	machineState[i] = 0;			// a recycled thread
+#endif
+    machineState[PCState] = (PtrInt) ThreadRoot;
+    machineState[StartupPCState] = (PtrInt) InterruptEnable;
+    machineState[InitialPCState] = (PtrInt) func;
     machineState[InitialArgState] = arg;
-    machineState[WhenDonePCState] = (int) ThreadFinish;
+    machineState[WhenDonePCState] = (PtrInt) ThreadFinish;
 }
 
+#ifdef CHANGED
+//----------------------------------------------------------------------
+// Thread::AllocateStack
+//	Get the memory for an execution stack from the host, unless we
+//	have one.  StackAllocate does the rest.
+//----------------------------------------------------------------------
+
+void
+Thread::AllocateStack()
+{
+    if (stack == NULL)
+	stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+}
+#endif
+
 #ifdef USER_PROGRAM
 #include "machine.h"
 
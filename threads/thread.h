@@ -39,15 +39,21 @@
 
 #include "copyright.h"
 #include "utility.h"
+#ifdef CHANGED
+#include "queue.h"
+#endif
 
 #ifdef USER_PROGRAM
 #include "machine.h"
 #include "addrspace.h"
+
+class Process;
 #endif
 
 // CPU register state to be saved on context switch.  
 // The SPARC and MIPS only need 10 registers, but the Snake needs 18.
 // For simplicity, this is just the max over all architectures.
+// Each is a PtrInt, so it can hold a register of a 64-bit host.
 #define MachineStateSize 18 
 
 
@@ -56,11 +62,51 @@
 #define StackSize	(4 * 1024)	// in words
 
 
+#ifdef CHANGED
+// Thread priorities, for the priority scheduler.  Bigger is more urgent.
+#define NumPriorities	32
+#define DefaultPriority	16
+
+// Stride scheduling: a thread holding "tickets" tickets has a stride of
+// StrideOne / tickets, and its pass advances by the stride for every
+// tick it runs, so the CPU is shared in proportion to tickets.
+#define DefaultTickets	100
+#define MaxTickets	1000
+#define StrideOne	(1 << 16)
+
+// Real-time threads: a periodic thread is released every "period" ticks,
+// may use up to "budget" ticks of CPU per period, and must finish each
+// job by the start of the next period.  Releases happen on timer
+// interrupts, so periods are in whole multiples of TimerTicks.
+#define MinPeriod	TimerTicks
+
+class Lock;
+
+// The following class records what a thread, or all the threads of a
+// process, did with the CPU: ticks spent running user code and kernel
+// code, ticks spent blocked, and how often it gave up the CPU.
+
+class CpuUsage {
+  public:
+    CpuUsage() { userTicks = systemTicks = blockedTicks = switches = 0; }
+    void Add(int user, int system, int blocked, int switched) {
+	userTicks += user; systemTicks += system;
+	blockedTicks += blocked; switches += switched;
+    }
+
+    int userTicks;
+    int systemTicks;
+    int blockedTicks;			// asleep, until made ready again
+    int switches;			// times switched out, for whatever
+					// reason
+};
+#endif
+
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
 // external function, dummy routine whose sole job is to call Thread::Print
-extern void ThreadPrint(int arg);	 
+extern void ThreadPrint(PtrInt arg);	 
 
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
@@ -77,8 +123,8 @@ class Thread {
   private:
     // NOTE: DO NOT CHANGE the order of these first two members.
     // THEY MUST be in this position for SWITCH to work.
-    int* stackTop;			 // the current stack pointer
-    int machineState[MachineStateSize];  // all registers except for stackTop
+    PtrInt* stackTop;			 // the current stack pointer
+    PtrInt machineState[MachineStateSize];  // all registers except for stackTop
 
   public:
     Thread(char* debugName);		// initialize a Thread 
@@ -89,7 +135,7 @@ class Thread {
 
     // basic thread operations
 
-    void Fork(VoidFunctionPtr func, int arg); 	// Make thread run (*func)(arg)
+    void Fork(VoidFunctionPtr func, PtrInt arg); 	// Make thread run (*func)(arg)
     void Yield();  				// Relinquish the CPU if any 
 						// other thread is runnable
     void Sleep();  				// Put the thread to sleep and 
@@ -99,9 +145,66 @@ class Thread {
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
     void setStatus(ThreadStatus st) { status = st; }
+#ifdef CHANGED
+    ThreadStatus getStatus() { return status; }
+#endif
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
 
+#ifdef CHANGED
+    // Scheduling state, kept by the Scheduler
+    int level;				// MLFQ queue the thread is on
+    int quantumUsed;			// timer ticks used at that level
+    int createdAt;			// when the thread was made, and
+    int firstRunAt;			// first ran (or -1), for response
+					// and turnaround times
+
+    void setPriority(int p);		// change the base priority
+    int getPriority() { return priority; }
+    void UpdatePriority();		// recompute "priority" from the base
+					// and the waiters on locks we hold
+    int basePriority;			// as set with setPriority
+    int priority;			// what we're scheduled at: the base,
+					// or higher if inherited
+    Lock *waitingOn;			// the lock we're blocked on, if any
+    Queue *locksHeld;			// locks we hold (priority policy only)
+
+    void setTickets(int n);		// our share under stride scheduling
+    int getTickets() { return tickets; }
+    int tickets;
+    int stride;				// StrideOne / tickets
+    unsigned int pass;			// virtual time; the least runs next
+    int cpuTicks;			// simulated ticks spent running
+    int account;			// our slot in the scheduler's report,
+					// or -1
+
+    void Account(int user, int system, int blocked, int switched);
+					// charge us, and our process
+    CpuUsage usage;			// what we did with the CPU
+    CpuUsage *processUsage;		// our process's usage, or NULL
+    int blockedAt;			// when we last went to sleep
+
+    bool SetRealTime(int period, int budget);
+					// make this a periodic thread, if
+					// the scheduler can admit it
+    void WaitForNextPeriod();		// this job is done; sleep until the
+					// next one is released
+    bool isRealTime() { return period > 0 && !throttled; }
+					// scheduled by earliest deadline now?
+    int period;				// 0 if not a real-time thread
+    int budget;
+    int deadline;			// end of the current period
+    int jobStart;			// cpuTicks when the job was released
+    bool throttled;			// used its budget: runs as an ordinary
+					// thread until the next release
+    int jobsDone;			// and what became of them
+    int deadlineMisses;
+    int overruns;
+
+    QueueLink queueLink;		// for the ready queue, or the wait
+					// queue of whatever we're blocked on
+#endif
+
   private:
     // some of the private data for this class is listed above
     
@@ -111,9 +214,18 @@ class Thread {
     ThreadStatus status;		// ready, running or blocked
     char* name;
 
-    void StackAllocate(VoidFunctionPtr func, int arg);
+    void StackAllocate(VoidFunctionPtr func, PtrInt arg);
     					// Allocate a stack for thread.
 					// Used internally by Fork()
+#ifdef CHANGED
+    void AllocateStack();		// get the stack itself, if we haven't
+					// one already
+    bool HasStack() { return stack != NULL; }
+    void Init(char* threadName);	// everything the constructor does
+					// but allocate; for reuse
+    friend class ThreadPool;
+    friend class Cpu;			// to start an idle thread
+#endif
 
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
@@ -127,6 +239,11 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+    Process *process;			// The process "space" belongs to.
+#ifdef CHANGED
+    int userStackTop;			// initial stack pointer of a forked
+					// thread, from AddrSpace::CreateStack
+#endif
 #endif
 };
 
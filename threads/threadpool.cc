@@ -0,0 +1,132 @@
+// threadpool.cc
+//	Routines to recycle Thread objects and their stacks.
+//
+//	Every forked thread needs a stack, and allocating one means an
+//	mprotect'ed host allocation (AllocBoundedArray) which is thrown
+//	away again when the thread finishes.  Tests that fork thousands
+//	of short-lived threads spend much of their time doing that.
+//	Instead, finished threads come back here with their stacks still
+//	attached, and Get hands them out again, so creating a thread is
+//	just a pop.  Fork re-initializes the stack's fencepost and the
+//	saved machine state, as it does for a new stack.
+//
+//	The pool starts with "lowWater" threads.  Once more than
+//	"highWater" have come back, it gives all but "lowWater" back to
+//	the host.  That way a burst doesn't tie up memory for good, and
+//	a workload that goes up and down around one size doesn't keep
+//	allocating and freeing.
+//
+//	Like the scheduler, this relies on interrupts being disabled for
+//	mutual exclusion.
+
+#ifdef CHANGED
+#include "copyright.h"
+#include "threadpool.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ThreadPool::ThreadPool
+// 	Make a pool, and stock it with "low" threads with their stacks
+//	allocated.
+//
+//	"low", "high" are the watermarks described above.
+//----------------------------------------------------------------------
+
+ThreadPool::ThreadPool(int low, int high)
+{
+    ASSERT(low >= 0 && low <= high && high > 0);
+    lowWater = low;
+    highWater = high;
+    idle = new Thread*[highWater + 1];	// room for one over, before a trim
+    count = 0;
+    reused = allocated = trimmed = 0;
+
+    while (count < lowWater) {
+	Thread *thread = new Thread("pooled");
+	thread->AllocateStack();
+	idle[count++] = thread;
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::~ThreadPool
+// 	Give every pooled thread back to the host.
+//----------------------------------------------------------------------
+
+ThreadPool::~ThreadPool()
+{
+    while (count > 0)
+	delete idle[--count];
+    delete [] idle;
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::Get
+// 	Return a thread, as if it had just been made with
+//	"new Thread(threadName)": from the pool if there's one there,
+//	otherwise from the host.
+//----------------------------------------------------------------------
+
+Thread *
+ThreadPool::Get(char *threadName)
+{
+    Thread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (count > 0) {
+	thread = idle[--count];
+	thread->Init(threadName);
+	reused++;
+    } else {
+	thread = new Thread(threadName);
+	allocated++;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::Put
+// 	Take back a thread that has finished, or was never forked.  The
+//	main thread didn't get its stack from us, so it is simply deleted.
+//	If that takes the pool over its high watermark, trim it back to
+//	the low one.
+//----------------------------------------------------------------------
+
+void
+ThreadPool::Put(Thread *thread)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(thread != currentThread);
+    if (!thread->HasStack()) {
+	delete thread;
+	(void) interrupt->SetLevel(oldLevel);
+	return;
+    }
+    DEBUG('t', "Recycling thread \"%s\"\n", thread->getName());
+    idle[count++] = thread;
+    if (count > highWater) {
+	DEBUG('t', "Thread pool over %d, trimming to %d\n", highWater,
+	      lowWater);
+	while (count > lowWater) {
+	    delete idle[--count];
+	    trimmed++;
+	}
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::Print
+// 	Print how well the pool is doing.  For debugging.
+//----------------------------------------------------------------------
+
+void
+ThreadPool::Print()
+{
+    printf("Thread pool: %d idle (low %d, high %d), %d reused, "
+	   "%d allocated, %d trimmed\n", count, lowWater, highWater,
+	   reused, allocated, trimmed);
+}
+#endif
@@ -0,0 +1,39 @@
+// threadpool.h
+//	Data structures for recycling finished threads, and their
+//	stacks, rather than going back to the host for every Fork.
+//
+//	See threadpool.cc for the details.
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include "copyright.h"
+#include "thread.h"
+
+// Default watermarks; nachos -tp <low> <high> overrides them.
+#define ThreadPoolLow	4
+#define ThreadPoolHigh	32
+
+class ThreadPool {
+  public:
+    ThreadPool(int low = ThreadPoolLow, int high = ThreadPoolHigh);
+					// stock up to the low watermark
+    ~ThreadPool();			// free everything still pooled
+
+    Thread *Get(char *threadName);	// a fresh thread, ready to Fork
+    void Put(Thread *thread);		// a thread that's done with;
+					// it must not be running
+    void Print();			// pool size and hit counts
+
+  private:
+    Thread **idle;			// stack of idle threads
+    int count;				// how many are on it
+    int lowWater;			// trim back to this many...
+    int highWater;			// ...once there are more than this
+
+    int reused;				// Gets served from the pool
+    int allocated;			// Gets that fell back on the host
+    int trimmed;			// threads given back to the host
+};
+
+#endif // THREADPOOL_H
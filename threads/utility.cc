@@ -14,7 +14,7 @@
 #ifdef HOST_SNAKE
 #include <stdarg.h>
 #else
-#ifdef HOST_SPARC
+#if defined(HOST_SPARC) || defined(HOST_x86_64)
 #include <stdarg.h>
 #else
 #include "/usr/include/stdarg.h"
@@ -47,8 +47,18 @@
 //
 // This is used by Thread::Fork and for interrupt handlers, as well
 // as a couple of other places.
-
-typedef void (*VoidFunctionPtr)(int arg); 
+//
+// The argument is often a pointer to an object, cast to an integer, so
+// it is a "PtrInt": an integer as wide as a pointer, which lets Nachos
+// run as a 64-bit program.
+
+#ifdef CHANGED
+#include <stdint.h>
+typedef intptr_t PtrInt;
+#else
+typedef int PtrInt;
+#endif
+typedef void (*VoidFunctionPtr)(PtrInt arg); 
 typedef void (*VoidNoArgFunctionPtr)(); 
 
 
@@ -51,8 +51,10 @@ SwapHeader (NoffHeader *noffH)
 //	Assumes that the object code file is in NOFF format.
 //
 //	First, set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	memory.  Each virtual page is given whichever physical frame is
+//	free in "memoryMap", so several programs can be resident at once.
+//	If there aren't enough free frames, the page table is left NULL
+//	(see IsLoaded).
 //
 //	"executable" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
@@ -60,7 +62,12 @@ SwapHeader (NoffHeader *noffH)
 AddrSpace::AddrSpace(OpenFile *executable)
 {
     NoffHeader noffH;
-    unsigned int i, size;
+    unsigned int size;
+
+    for (int i = 0; i < MaxAttached; i++)
+	attached[i] = NULL;
+    for (int i = 0; i < MaxSegments; i++)
+	created[i] = NULL;
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -68,48 +75,44 @@ AddrSpace::AddrSpace(OpenFile *executable)
     	SwapHeader(&noffH);
     ASSERT(noffH.noffMagic == NOFFMAGIC);
 
-// how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
-			+ UserStackSize;	// we need to increase the size
-						// to leave room for the stack
-    numPages = divRoundUp(size, PageSize);
+// how big is address space?  The program, then room for the heap to
+// grow into, then the stack at the top.
+    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size;
+    heapStart = divRoundUp(size, PageSize);
+    heapEnd = heapStart + divRoundUp(UserHeapSize, PageSize);
+    brk = heapStart * PageSize;
+    numPages = heapEnd + divRoundUp(UserStackSize, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
-
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
-// first, set up the translation 
+// first, set up the translation; the heap is left unmapped
     pageTable = new TranslationEntry[numPages];
-    for (i = 0; i < numPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-	pageTable[i].physicalPage = i;
-	pageTable[i].valid = TRUE;
-	pageTable[i].use = FALSE;
-	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
+    for (unsigned int i = heapStart; i < heapEnd; i++) {
+	pageTable[i].virtualPage = i;
+	pageTable[i].valid = FALSE;
     }
-    
-// zero out the entire address space, to zero the unitialized data segment 
-// and the stack segment
-    bzero(machine->mainMemory, size);
+    if (memoryMap->NumClear() < (int) (numPages - (heapEnd - heapStart))) {
+	DEBUG('a', "Not enough free frames for %d pages\n", numPages);
+	delete [] pageTable;		// run something smaller, or wait
+	pageTable = NULL;		// until another program exits
+	numPages = 0;
+	return;
+    }
+    AllocatePages(pageTable, 0, heapStart);
+    AllocatePages(pageTable, heapEnd, numPages);
 
 // then, copy in the code and data segments into memory
     if (noffH.code.size > 0) {
         DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
 			noffH.code.virtualAddr, noffH.code.size);
-        executable->ReadAt(&(machine->mainMemory[noffH.code.virtualAddr]),
-			noffH.code.size, noffH.code.inFileAddr);
+        LoadSegment(executable, noffH.code.virtualAddr, noffH.code.size,
+			noffH.code.inFileAddr);
     }
     if (noffH.initData.size > 0) {
         DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
 			noffH.initData.virtualAddr, noffH.initData.size);
-        executable->ReadAt(&(machine->mainMemory[noffH.initData.virtualAddr]),
+        LoadSegment(executable, noffH.initData.virtualAddr,
 			noffH.initData.size, noffH.initData.inFileAddr);
     }
 
@@ -117,12 +120,26 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space, returning its frames to "memoryMap".
+//	Attached shared segments are detached first, since their frames
+//	belong to the segment, not to us, and then the references taken
+//	by CreateSegment are dropped.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   delete pageTable;
+#ifdef CHANGED
+    for (int slot = 0; slot < MaxAttached; slot++)
+	if (attached[slot] != NULL)
+	    (void) DetachSegment(attachedPage[slot] * PageSize);
+    for (int id = 0; id < MaxSegments; id++)
+	if (created[id] != NULL)
+	    sharedMemory->Detach(created[id]);
+#endif
+    for (unsigned int i = 0; i < numPages; i++)
+	if (pageTable[i].valid)
+	    memoryMap->Clear(pageTable[i].physicalPage);
+    delete [] pageTable;
 }
 
 
@@ -134,36 +151,31 @@ AddrSpace::~AddrSpace()
 // - Adds new pages to the page table. Makes the same calculation as
 //   was made in the address space constructor - adds UserStackSize/PageSize pages
 //   to the page table.
-// Show an error message if no memory is available.
-bool AddrSpace::CreateStack()
+// Returns the initial stack pointer for the new stack, which stays put
+// even if a segment is attached past it later, or -1 if no memory is
+// available.
+int AddrSpace::CreateStack()
 {
   int numNewPages = divRoundUp(UserStackSize, PageSize);
-  int newSize = (numPages + numNewPages) * PageSize;
+  TranslationEntry *newPageTable = new TranslationEntry[numPages + numNewPages];
 
-  if (numPages + numNewPages <= NumPhysPages)
-  {
-    TranslationEntry *newPageTable = new TranslationEntry[numPages + numNewPages];
-    
-    int i;
-    for (i = 0; i < numPages; i++) {
-      newPageTable[i] = pageTable[i];
-    }
-    for (i = numPages; i < numPages + numNewPages; i++)
-    {
-	newPageTable[i].virtualPage = i;
-	newPageTable[i].physicalPage = i;
-	newPageTable[i].valid = TRUE;
-	newPageTable[i].use = FALSE;
-	newPageTable[i].dirty = FALSE;
-	newPageTable[i].readOnly = FALSE;
-    }
-    pageTable = newPageTable;
-    numPages = (numPages + numNewPages);
-    return true;
-  } else {
+  unsigned int i;
+  for (i = 0; i < numPages; i++) {
+    newPageTable[i] = pageTable[i];
+  }
+  if (!AllocatePages(newPageTable, numPages, numPages + numNewPages)) {
     DEBUG('a', "No room available on the stack");
-    return false;
+    delete [] newPageTable;
+    return -1;
   }
+  delete [] pageTable;
+  pageTable = newPageTable;
+  numPages = (numPages + numNewPages);
+
+  // Only the running process forks, so the machine is still pointing
+  // at the table we just deleted.
+  RestoreState();
+  return numPages * PageSize - 16;
 }
 
 // Removes a stack allocation created in MakeStack once a thread is "Finish()ed"
@@ -181,6 +193,280 @@ unsigned int AddrSpace::GetNumPages()
   return numPages;
 }
 
+
+// Give each page in [from, to) of "table" a zeroed physical frame.
+//
+// Either all of the pages are mapped or, if memory runs out part way,
+// none of them are: the frames taken so far are handed back.
+bool AddrSpace::AllocatePages(TranslationEntry *table, int from, int to)
+{
+  if (memoryMap->NumClear() < to - from)
+    return false;
+
+  for (int i = from; i < to; i++) {
+    table[i].virtualPage = i;
+    table[i].physicalPage = memoryMap->Find();
+    table[i].valid = TRUE;
+    table[i].use = FALSE;
+    table[i].dirty = FALSE;
+    table[i].readOnly = FALSE;  // if the code segment was entirely on 
+				// a separate page, we could set its 
+				// pages to be read-only
+    ASSERT(table[i].physicalPage >= 0);
+    bzero(&machine->mainMemory[table[i].physicalPage * PageSize], PageSize);
+  }
+  return true;
+}
+
+
+// Read "size" bytes at "inFileAddr" of the executable into the
+// address space at "virtualAddr".  Frames aren't contiguous any more,
+// so this is done one page at a time.
+void AddrSpace::LoadSegment(OpenFile *executable, int virtualAddr, int size,
+			    int inFileAddr)
+{
+  while (size > 0) {
+    int chunk = min(size, PageSize - (virtualAddr % PageSize));
+    int physAddr = Translate(virtualAddr);
+
+    ASSERT(physAddr >= 0);
+    executable->ReadAt(&(machine->mainMemory[physAddr]), chunk, inFileAddr);
+    virtualAddr += chunk;
+    inFileAddr += chunk;
+    size -= chunk;
+  }
+}
+
+
+// Translate a user virtual address to an offset in machine->mainMemory,
+// without going through the (simulated) MMU -- the kernel uses this for
+// syscall arguments, so a bad pointer must not raise an exception.
+// Returns -1 if the address isn't mapped.
+int AddrSpace::Translate(int virtAddr)
+{
+  unsigned int vpn = (unsigned) virtAddr / PageSize;
+  unsigned int offset = (unsigned) virtAddr % PageSize;
+
+  if (virtAddr < 0 || vpn >= numPages)
+    return -1;
+  if (!pageTable[vpn].valid && !DemandPage(virtAddr))
+    return -1;
+  return pageTable[vpn].physicalPage * PageSize + offset;
+}
+
+
+// Copy "size" bytes out of user memory at "virtAddr" into "into".
+bool AddrSpace::ReadMemory(int virtAddr, char *into, int size)
+{
+  while (size > 0) {
+    int chunk = min(size, PageSize - (virtAddr % PageSize));
+    int physAddr = Translate(virtAddr);
+
+    if (physAddr < 0)
+      return false;
+    bcopy(&machine->mainMemory[physAddr], into, chunk);
+    virtAddr += chunk;
+    into += chunk;
+    size -= chunk;
+  }
+  return true;
+}
+
+
+// Copy "size" bytes from "from" into user memory at "virtAddr".
+bool AddrSpace::WriteMemory(int virtAddr, char *from, int size)
+{
+  while (size > 0) {
+    int chunk = min(size, PageSize - (virtAddr % PageSize));
+    int physAddr = Translate(virtAddr);
+
+    if (physAddr < 0)
+      return false;
+    bcopy(from, &machine->mainMemory[physAddr], chunk);
+    pageTable[virtAddr / PageSize].dirty = TRUE;
+    virtAddr += chunk;
+    from += chunk;
+    size -= chunk;
+  }
+  return true;
+}
+
+
+// Copy a null terminated string out of user memory.  At most "maxSize"
+// bytes (including the null) are copied; a string that doesn't fit,
+// or that runs off the end of the address space, is an error.
+bool AddrSpace::ReadString(int virtAddr, char *into, int maxSize)
+{
+  for (int i = 0; i < maxSize; i++) {
+    int physAddr = Translate(virtAddr + i);
+
+    if (physAddr < 0)
+      return false;
+    into[i] = machine->mainMemory[physAddr];
+    if (into[i] == '\0')
+      return true;
+  }
+  return false;
+}
+
+
+// Find or make the segment called "name" (see SharedMemory::Create).
+// The first Create of each segment takes a reference that lasts until
+// this address space is deleted, so its id stays good for us even if
+// nothing else holds on to it.
+int AddrSpace::CreateSegment(char *name, int size)
+{
+  return sharedMemory->Create(name, size, created);
+}
+
+
+// Map "segment" into this address space.  A caller-chosen "virtAddr"
+// must be page aligned and every page it covers unmapped; the page
+// table is grown if it reaches past the end, but not beyond
+// MaxUserPages.  With "virtAddr" zero the
+// first hole big enough is used, or else the end of the address space.
+//
+// The caller has already taken a reference on "segment"; it is handed
+// back by DetachSegment (or the destructor).
+int AddrSpace::AttachSegment(SharedSegment *segment, int virtAddr)
+{
+  int pages = segment->NumPages();
+  int slot, first, i;
+
+  for (slot = 0; slot < MaxAttached; slot++)
+    if (attached[slot] == NULL)
+      break;
+  if (slot == MaxAttached || virtAddr < 0 || virtAddr % PageSize != 0)
+    return -1;
+
+  if (virtAddr != 0) {
+    first = virtAddr / PageSize;
+    for (i = first; i < first + pages && i < (int) numPages; i++)
+      if (pageTable[i].valid || InHeap(i))
+	return -1;
+  } else {
+    int run = 0;
+    for (first = 0; first < (int) numPages && run < pages; first++)
+      run = (pageTable[first].valid || InHeap(first)) ? 0 : run + 1;
+    first -= run;			// start of the hole, or numPages
+  }
+  if (first + pages > MaxUserPages)
+    return -1;
+  if (first + pages > (int) numPages)
+    GrowPageTable(first + pages);
+
+  for (i = 0; i < pages; i++) {
+    pageTable[first + i].physicalPage = segment->Frame(i);
+    pageTable[first + i].valid = TRUE;
+    pageTable[first + i].use = FALSE;
+    pageTable[first + i].dirty = FALSE;
+    pageTable[first + i].readOnly = FALSE;
+  }
+  attached[slot] = segment;
+  attachedPage[slot] = first;
+  DEBUG('a', "Attached shared segment %s at 0x%x\n", segment->getName(),
+	first * PageSize);
+  return first * PageSize;
+}
+
+
+// Unmap the segment attached at "virtAddr" and drop our reference to
+// it.  The pages become a hole that a later attach can reuse.
+bool AddrSpace::DetachSegment(int virtAddr)
+{
+  int slot;
+
+  for (slot = 0; slot < MaxAttached; slot++)
+    if (attached[slot] != NULL && attachedPage[slot] * PageSize == virtAddr)
+      break;
+  if (slot == MaxAttached)
+    return false;
+
+  for (int i = 0; i < attached[slot]->NumPages(); i++)
+    pageTable[attachedPage[slot] + i].valid = FALSE;
+  sharedMemory->Detach(attached[slot]);
+  attached[slot] = NULL;
+  return true;
+}
+
+
+// Move the break.  Growing only reserves address space -- DemandPage
+// finds frames as the pages are used -- while shrinking hands back the
+// frames of any page wholly above the new break.
+//
+// A page the break only partly left keeps its frame, and whatever was
+// written above the break; growing over it again clears that, so new
+// heap memory always reads as zero.
+int AddrSpace::Sbrk(int increment)
+{
+  int oldBrk = brk;
+  int newBrk = brk + increment;
+
+  if (newBrk < (int) (heapStart * PageSize) || newBrk > (int) (heapEnd * PageSize))
+    return -1;
+  for (int addr = oldBrk; addr < newBrk; ) {
+    unsigned int vpn = addr / PageSize;
+    int chunk = min(newBrk - addr, PageSize - (addr % PageSize));
+
+    if (pageTable[vpn].valid)		// untouched pages are zeroed later
+      bzero(&machine->mainMemory[pageTable[vpn].physicalPage * PageSize
+				 + addr % PageSize], chunk);
+    addr += chunk;
+  }
+  for (unsigned int i = divRoundUp(newBrk, PageSize); i < heapEnd; i++) {
+    if (pageTable[i].valid) {
+      memoryMap->Clear(pageTable[i].physicalPage);
+      pageTable[i].valid = FALSE;
+    }
+  }
+  brk = newBrk;
+  DEBUG('a', "Break moved from 0x%x to 0x%x\n", oldBrk, brk);
+  return oldBrk;
+}
+
+
+// Give the heap page holding "virtAddr" a zero-filled frame.  Called on
+// a page fault, and when the kernel copies to or from a heap page the
+// program hasn't touched yet.
+bool AddrSpace::DemandPage(int virtAddr)
+{
+  unsigned int vpn = (unsigned) virtAddr / PageSize;
+
+  if (virtAddr < 0 || !InHeap(vpn) || virtAddr >= brk)
+    return false;
+  if (pageTable[vpn].valid)
+    return true;
+  if (!AllocatePages(pageTable, vpn, vpn + 1)) {
+    DEBUG('a', "No free frame for heap page %d\n", vpn);
+    return false;
+  }
+  stats->numPageFaults++;
+  DEBUG('a', "Heap page %d is frame %d\n", vpn, pageTable[vpn].physicalPage);
+  return true;
+}
+
+
+// Extend the page table to "pages" entries.  The new entries are left
+// unmapped.
+void AddrSpace::GrowPageTable(unsigned int pages)
+{
+  TranslationEntry *newPageTable = new TranslationEntry[pages];
+  unsigned int i;
+
+  for (i = 0; i < numPages; i++)
+    newPageTable[i] = pageTable[i];
+  for (; i < pages; i++) {
+    newPageTable[i].virtualPage = i;
+    newPageTable[i].valid = FALSE;
+  }
+  delete [] pageTable;
+  pageTable = newPageTable;
+  numPages = pages;
+
+  // As in CreateStack, this is the running address space.
+  RestoreState();
+}
+
 #endif
 
 //----------------------------------------------------------------------
@@ -16,8 +16,16 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "translate.h"
+#ifdef CHANGED
+#include "sharedmemory.h"
+#endif
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define MaxAttached		8	// shared segments mapped at once
+#define MaxUserPages		1024	// furthest a segment may be attached
+#define UserHeapSize		8192	// most the heap can grow to with Sbrk;
+					// only pages actually touched get a
+					// physical frame
 
 class AddrSpace {
   public:
@@ -33,9 +41,39 @@ class AddrSpace {
     void RestoreState();		// info on a context switch 
 
     #ifdef CHANGED
-    // Stacks - make new stacks and remove old ones...
-    bool CreateStack();
+    // Stacks - make new stacks and remove old ones...  CreateStack
+    // returns the new stack's initial stack pointer, or -1.
+    int CreateStack();
     unsigned int GetNumPages();
+
+    bool IsLoaded() { return pageTable != NULL; }
+					// FALSE if there were not enough
+					// free frames to load the program
+
+    // Copy data between the kernel and this address space.  These walk
+    // the page table, since virtual pages are no longer laid out 1:1
+    // in physical memory.  Return FALSE on a bad user address.
+    bool ReadMemory(int virtAddr, char *into, int size);
+    bool WriteMemory(int virtAddr, char *from, int size);
+    bool ReadString(int virtAddr, char *into, int maxSize);
+
+    // Shared memory - find or make the segment called "name", holding
+    // a reference to it until we go away.  Returns its id, or -1.
+    int CreateSegment(char *name, int size);
+
+    // Map a segment's frames into this address space at "virtAddr"
+    // (page aligned), or wherever there's room if it is zero.  Returns
+    // the address used, or -1.
+    int AttachSegment(SharedSegment *segment, int virtAddr);
+    bool DetachSegment(int virtAddr);	// unmap the segment there
+
+    // Heap - the break starts just after the program's data and moves
+    // by "increment" bytes.  Returns the old break, or -1.  Heap pages
+    // are filled with zeroes the first time they are touched.
+    int Sbrk(int increment);
+    bool DemandPage(int virtAddr);	// map the heap page at virtAddr, on
+					// a page fault; FALSE if it isn't
+					// below the break
     #endif
 
   private:
@@ -43,6 +81,25 @@ class AddrSpace {
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+
+    #ifdef CHANGED
+    bool AllocatePages(TranslationEntry *table, int from, int to);
+    					// give pages [from, to) a free frame
+    void LoadSegment(OpenFile *executable, int virtualAddr, int size,
+		     int inFileAddr);	// copy a segment in, page by page
+    int Translate(int virtAddr);	// physical address, or -1
+    void GrowPageTable(unsigned int pages);
+					// add invalid entries up to "pages"
+
+    SharedSegment *attached[MaxAttached];  // segments mapped here, and
+    int attachedPage[MaxAttached];	   // the first page of each
+    SharedSegment *created[MaxSegments];   // by id, segments we Created;
+					   // each holds a reference
+
+    unsigned int heapStart, heapEnd;	// pages reserved for the heap
+    int brk;				// the current break
+    bool InHeap(unsigned int vpn) { return vpn >= heapStart && vpn < heapEnd; }
+    #endif
 };
 
 #endif // ADDRSPACE_H
@@ -28,43 +28,115 @@
 #include "syscall.h"
 #include "process.h"
 #include "syncconsole.h"
+#include "futex.h"
 
 #ifdef CHANGED
 // COMP 305 Project #2
 // Copyright David Petrie 2008
-static List* Processes;
-static Process* currentProcess;
 static SynchConsole* console;
 
+// The process table.  A process's SpaceId is its index in the table; the
+// slot is held until the process has exited *and* been Join()ed (or its
+// parent has gone away), so that Join can still collect the exit status.
+static Process* processTable[MAX_PROCESSES];
+static Lock* processTableLock;
+static int liveProcesses;	// processes that haven't exited yet
+
+// Wait queues for the Wait and Wake syscalls.
+static FutexTable* futexTable;
+
+// A ProcessUsage for every process put in the table, in order, for the
+// report at Halt.
+static List* usageLog;
+
 //----------------------------------------------------------------------
 // The InitExceptions function is used to initialize various useful things
 //----------------------------------------------------------------------
 void
 InitExceptions(){
   console = new SynchConsole(NULL, NULL);
-  Processes = new List();
+  processTableLock = new Lock("process table lock");
+  for (int i = 0; i < MAX_PROCESSES; i++)
+    processTable[i] = NULL;
+  liveProcesses = 0;
+  futexTable = new FutexTable();
+  usageLog = new List();
+}
+
+// Give the process a free SpaceId.  The caller must hold the process
+// table lock.  Returns -1 if the table is full.
+static int
+InstallProcess(Process* process)
+{
+  for (int id = 0; id < MAX_PROCESSES; id++) {
+    if (processTable[id] == NULL) {
+      processTable[id] = process;
+      process->SetSpaceId(id);
+      process->GetUsage()->spaceId = id;
+      usageLog->Append(process->GetUsage());
+      liveProcesses++;
+      return id;
+    }
+  }
+  return -1;
+}
+
+// A record of "n"'s CPU usage, not yet in the usage log.
+ProcessUsage::ProcessUsage(char* n)
+{
+  name = new char[strlen(n) + 1];
+  strcpy(name, n);
+  spaceId = -1;
+}
+
+// Print one line of ProcessUsageReport.
+static void
+PrintUsage(PtrInt arg)
+{
+  ProcessUsage* u = (ProcessUsage*)arg;
+
+  printf("%5d %-24s %10d %10d %10d %9d\n", u->spaceId, u->name,
+	 u->userTicks, u->systemTicks, u->blockedTicks, u->switches);
 }
 
-// Add a new process into the list and make it the current process
+// Print the CPU usage of every process that has been in the table, at
+// Halt (with -sr).  SpaceIds are reused, so one may appear more than once.
+void
+ProcessUsageReport()
+{
+  if (usageLog == NULL || usageLog->IsEmpty())
+    return;
+  printf("\nCPU usage, by process:\n");
+  printf("%5s %-24s %10s %10s %10s %9s\n", "id", "name", "user",
+	 "system", "blocked", "switches");
+  usageLog->Mapcar((VoidFunctionPtr) PrintUsage);
+}
+
+// Add the first process into the table and make it the current process
 void
 InitProcess(Process* process)
 {
-    Processes->Append(process);
-    currentProcess = process;
+    processTableLock->Acquire();
+    ASSERT(InstallProcess(process) >= 0);
+    processTableLock->Release();
+    currentThread->process = process;
 }
 
 
 
 // Ensures that the forked thread begins execution at the correct position.
-void ForkUserThread(int funcPtr)
+void ForkUserThread(PtrInt arg)
 {
+  int funcPtr = (int) arg;		// a user virtual address
+
   DEBUG('t', "Setting machine PC to funcPtr for thread %s: 0x%x...\n", currentThread->getName(), funcPtr);
  
   currentThread->space->InitRegisters();
   currentThread->space->RestoreState();
   
-  // update the stack register
-  machine->WriteRegister(StackReg, currentThread->space->GetNumPages() * PageSize - 16);
+  // update the stack register -- from when the stack was made, since a
+  // segment may have been attached past it since
+  machine->WriteRegister(StackReg, currentThread->userStackTop);
 
   // Set the program counter to the appropriate place indicated by funcPtr...
   machine->WriteRegister(PCReg, funcPtr);
@@ -74,6 +146,20 @@ void ForkUserThread(int funcPtr)
 
 
 
+// First code run by the main thread of an Exec'd process -- the same
+// as the tail end of StartProcess.
+void ExecUserProcess(PtrInt dummy)
+{
+  DEBUG('t', "Starting process %s in thread %s\n", currentThread->process->getName(), currentThread->getName());
+
+  currentThread->space->InitRegisters();
+  currentThread->space->RestoreState();
+  machine->Run();
+  ASSERT(FALSE);			// machine->Run never returns
+}
+
+
+
 // increment the PC
 void IncrementPC()
 {
@@ -122,13 +208,14 @@ void IncrementPC()
 // PC. "
 //
 // Each system call has a return value. If this value is false at any time
-// it means there was an error in the user program. The response here should
-// be to just shut down the process and free the memory. However, since
-// nachos runs the user program in the "main" thread, we just call 
-// interrupt->halt() in order to shut down the program.
+// it means there was an error in the user program. The response here is
+// to kill the process: each of its threads exits at its next trap, and
+// the memory is freed when the last one goes -- other processes keep
+// running.
 void
 ExceptionHandler(ExceptionType which)
 {
+  Process* currentProcess = currentThread->process;
   bool result = true;
   int type = machine->ReadRegister(2);
   int arg1 = machine->ReadRegister(4);
@@ -138,22 +225,31 @@ ExceptionHandler(ExceptionType which)
 
   DEBUG('a', "Syscall Args %d, %d, %d, %d\n", arg1, arg2, arg3, arg4);
 
+  if (currentProcess->IsKilled()) {
+    DEBUG('p', "Thread %s of a killed process exiting.\n", currentThread->getName());
+    currentProcess->ExitProcess(-1);
+  }
+
   if (which == SyscallException)
   {
     switch (type) {
     case SC_Halt:
       // Need to deal with any data structures here.
       DEBUG('a', "Shutdown, initiated by user program.\n");
+      console->Flush();
       interrupt->Halt();
       break;
     case SC_Exit:
       DEBUG('a', "Exit, initiated by user program.\n");
-      // If there is only one thread left in the process then delete the
-      // process and halt.
-      if (currentProcess->ExitProcess(arg1)) {
-	delete currentProcess;
-	return;
-      }
+      // If this is the last thread left in the process then the process
+      // goes away too.  Either way, we don't come back.
+      currentProcess->ExitProcess(arg1);
+      break;
+    case SC_Exec:
+      result = currentProcess->ProcessExec(arg1);
+      break;
+    case SC_Join:
+      result = currentProcess->ProcessJoin(arg1);
       break;
     case SC_Create: 
       result = currentProcess->FileCreate(arg1);
@@ -170,6 +266,18 @@ ExceptionHandler(ExceptionType which)
     case SC_Close:
       result = currentProcess->FileClose(arg1);
       break;
+    case SC_Pipe:
+      result = currentProcess->ProcessPipe(arg1);
+      break;
+    case SC_SegmentCreate:
+      result = currentProcess->SegmentCreate(arg1, arg2);
+      break;
+    case SC_SegmentAttach:
+      result = currentProcess->SegmentAttach(arg1, arg2);
+      break;
+    case SC_SegmentDetach:
+      result = currentProcess->SegmentDetach(arg1);
+      break;
     case SC_Fork:
       result = currentProcess->ProcessFork(arg1);
       break;
@@ -177,20 +285,42 @@ ExceptionHandler(ExceptionType which)
       currentProcess->ProcessYield();
       result = true;
       break;
+    case SC_Wait:
+      result = currentProcess->FutexWait(arg1, arg2);
+      break;
+    case SC_Wake:
+      result = currentProcess->FutexWake(arg1, arg2);
+      break;
+    case SC_Sbrk:
+      result = currentProcess->ProcessSbrk(arg1);
+      break;
+    case SC_SetTickets:
+      result = currentProcess->ProcessSetTickets(arg1);
+      break;
+    case SC_GetUsage:
+      result = currentProcess->ProcessGetUsage(arg1, arg2);
+      break;
     default:
       printf("Unexpected user mode exception %d %d\n", which, type);
       ASSERT(FALSE);
       break;
     }
+  } else if (which == PageFaultException) {
+    // First touch of a heap page: map it and run the instruction again,
+    // so the PC is left alone.  Anything else is a bad address.
+    int badVAddr = machine->ReadRegister(BadVAddrReg);
+    if (currentThread->space->DemandPage(badVAddr))
+      return;
+    DEBUG('p', "Bad user address 0x%x - killing process.\n", badVAddr);
+    currentProcess->KillProcess();
   } else {
     printf("Unexpected user mode exception %d %d\n", which, type);
     ASSERT(FALSE);
   }
   IncrementPC();
   if (result == false) {
-    DEBUG('p', "ERROR in user program - shutting down process.\n");
-    interrupt->Halt();
-    delete currentProcess;
+    DEBUG('p', "ERROR in user program - killing process.\n");
+    currentProcess->KillProcess();
   }
 }
 
@@ -198,57 +328,228 @@ ExceptionHandler(ExceptionType which)
 
 
 // Process constructor
-Process::Process(char* n)
+//
+// "pThread" is the process's main thread; its address space becomes
+// the process's address space.
+Process::Process(char* n, Thread* pThread)
   {
-    name = n;
-    processThread = currentThread;
+    name = new char[strlen(n) + 1];
+    strcpy(name, n);
+    spaceId = -1;
+    processThread = pThread;
+    space = pThread->space;
     threads = new List();
     threadCount = 0;
     fileCounter = 0;
+    parent = NULL;
+    liveThreads = 1;
+    exited = FALSE;
+    exitStatus = 0;
+    killed = FALSE;
+    exitCondition = new Condition("process exit");
+    usage = new ProcessUsage(n);
+    pThread->processUsage = usage;
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+      openFileTable[i] = NULL;
+      pipeTable[i] = NULL;
+      pipeWriter[i] = FALSE;
+    }
   }
 
 
 
-// Delete all the threads associated with this process.
+// The threads themselves are deleted by the scheduler once they Finish(),
+// so all that's left here is the bookkeeping.
   Process::~Process()
   {
-    Thread* threadToDelete;
-    while(!threads->IsEmpty()) {
-      threadToDelete = (Thread *)threads->Remove();
-      delete threadToDelete;
-    }
+    ReleaseResources();
     delete threads;
-    delete openFileTable;
+    delete exitCondition;
+    delete [] name;
+    if (usage->spaceId < 0)	// never ran, so not in the usage log
+      delete usage;
+  }
+
+
+
+  // Free everything the process holds apart from its process table slot,
+  // which a zombie keeps until it's been Join()ed.
+  void Process::ReleaseResources()
+  {
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+      delete openFileTable[i];
+      openFileTable[i] = NULL;
+      ClosePipe(i);
+    }
+    delete space;
+    space = NULL;
   }
 
 
 
-  // Three situations:
-  // - If the exiting thread is the main process that initialised this process
-  //   and there are no other threads running, then return true. The exception
-  //   handler will delete the process.
-  // - If the exiting thread is the main thread that initialised the process
-  //   but there are other threads running, then simply finish the current thread.
-  // - If a forked thread is exiting, then decrement the thread count and 
-  //   finish the thread.
-  bool Process::ExitProcess(int status) 
+  // The process is exiting, so nobody is going to Join its children.
+  // Children that have already exited are reaped now; the others will
+  // reap themselves when they exit.  Process table lock must be held.
+  void Process::OrphanChildren()
   {
+    for (int id = 0; id < MAX_PROCESSES; id++) {
+      Process* child = processTable[id];
+      if (child == NULL || child->parent != this)
+	continue;
+      child->parent = NULL;
+      if (child->exited) {
+	processTable[id] = NULL;
+	delete child;
+      }
+    }
+  }
+
+
+
+  // Called by every thread of the process when it exits.
+  //
+  // - The main thread's "status" is the exit status of the process,
+  //   unless the process has been killed.
+  // - When the last thread leaves, the address space and open files are
+  //   freed and anyone blocked in Join() is woken.  If no parent is left
+  //   to Join() us, the process table slot is freed straight away.
+  // - When the last process leaves, there's nothing left to run, so
+  //   halt the machine.
+  void Process::ExitProcess(int status) 
+  {
+    processTableLock->Acquire();
     if (currentThread == processThread) {
-      if (threadCount == 0) {
-	DEBUG('p', "Exiting the main thread\n");
-	interrupt->Halt();
-	return true;
+      if (!killed)
+	exitStatus = status;
+      processThread = NULL;	// the Thread may be reused by another process
+    }
+    liveThreads--;
+    ASSERT(liveThreads >= 0);
+
+    if (liveThreads == 0) {
+      DEBUG('p', "Process %d (%s) exiting with status %d\n", spaceId, name, exitStatus);
+      currentThread->space = NULL;	// so the scheduler doesn't save
+      currentThread->process = NULL;	// user state into a freed space
+      ReleaseResources();
+      OrphanChildren();
+      exited = TRUE;
+      liveProcesses--;
+      if (parent != NULL) {
+	exitCondition->Broadcast(processTableLock);
       } else {
-	currentThread->Finish();
-	return false;
+	processTable[spaceId] = NULL;
+	delete this;
+      }
+      if (liveProcesses == 0) {
+	DEBUG('p', "Last process has exited\n");
+	console->Flush();
+	interrupt->Halt();
       }
     } else {
-      ASSERT(currentThread != this->processThread);
-      DEBUG('p', "Exiting a forked thread.\n");
-      threadCount--;
-      currentThread->Finish();
+      DEBUG('p', "Exiting thread %s\n", currentThread->getName());
+    }
+    processTableLock->Release();
+    currentThread->Finish();
+  }
+
+
+
+  // A thread faulted.  Mark the process killed, so that the others exit
+  // at their next trap (see ExceptionHandler), and finish this thread.
+  void Process::KillProcess()
+  {
+    processTableLock->Acquire();
+    killed = TRUE;
+    exitStatus = -1;
+    processTableLock->Release();
+    ExitProcess(-1);
+  }
+
+
+
+  // Exec: load the program named at ptrFileName into a new address space
+  // and start it running in a new thread.  The new SpaceId is returned in
+  // r2, or -1 if the program couldn't be loaded (no such file, not enough
+  // memory, or a full process table).
+  bool Process::ProcessExec(int ptrFileName)
+  {
+    char fileName[MAX_FILENAME];
+    if (!space->ReadString(ptrFileName, fileName, MAX_FILENAME)) {
+      DEBUG('p', "Could not find file name in memory.\n");
       return false;
     }
+
+    DEBUG('p', "Exec %s\n", fileName);
+    machine->WriteRegister(2, -1);
+
+    OpenFile* executable = fileSystem->Open(fileName);
+    if (executable == NULL) {
+      DEBUG('p', "Unable to open file %s\n", fileName);
+      return true;
+    }
+    AddrSpace* newSpace = new AddrSpace(executable);
+    delete executable;
+    if (!newSpace->IsLoaded()) {
+      DEBUG('p', "Not enough memory to run %s\n", fileName);
+      delete newSpace;
+      return true;
+    }
+
+    char* tname = (char *)malloc(sizeof(char) * (16 + strlen(fileName)));
+    sprintf(tname, "Process - %s", fileName);
+    Thread* thread = threadPool->Get(tname);
+    thread->space = newSpace;
+    Process* child = new Process(fileName, thread);
+
+    processTableLock->Acquire();
+    int id = InstallProcess(child);
+    if (id >= 0)
+      child->parent = this;
+    processTableLock->Release();
+    if (id < 0) {
+      DEBUG('p', "Process table is full.\n");
+      delete child;			// takes newSpace with it
+      threadPool->Put(thread);
+      return true;
+    }
+
+    child->InheritPipes(this);
+    thread->process = child;
+    thread->Fork(ExecUserProcess, 0);
+    machine->WriteRegister(2, id);
+    return true;
+  }
+
+
+
+  // Join: block until the child "id" has exited, then return its exit
+  // status in r2 and free its process table slot.  Returns -1 if "id"
+  // isn't one of our children.
+  bool Process::ProcessJoin(int id)
+  {
+    int status = -1;
+    Process* child = NULL;
+
+    processTableLock->Acquire();
+    if (id >= 0 && id < MAX_PROCESSES)
+      child = processTable[id];
+    if (child == NULL || child->parent != this) {
+      DEBUG('p', "Join on %d, which is not a child of %s\n", id, name);
+    } else {
+      // Another thread of ours may Join the same child and reap it first.
+      while (processTable[id] == child && !child->exited)
+	child->exitCondition->Wait(processTableLock);
+      if (processTable[id] == child) {
+	status = child->exitStatus;
+	processTable[id] = NULL;
+	delete child;
+      }
+    }
+    processTableLock->Release();
+
+    DEBUG('p', "Join on %d returned %d\n", id, status);
+    machine->WriteRegister(2, status);
+    return true;
   }
 
 
@@ -256,8 +557,8 @@ Process::Process(char* n)
    // Create a file with the name stored in machine memory at ptrFileName.
   bool Process::FileCreate(int ptrFileName)
   {
-    char* fileName = &machine->mainMemory[ptrFileName];
-    if (fileName == NULL) {
+    char fileName[MAX_FILENAME];
+    if (!space->ReadString(ptrFileName, fileName, MAX_FILENAME)) {
       // This error is actually serious enough to warrant a halt.
       DEBUG('p', "Could not find file name in memory.\n");
       return false;
@@ -291,14 +592,15 @@ Process::Process(char* n)
     //
     // might be better simply to block the thread on a condition variable
     // until one of them closes...
-    if (fileCounter - FID_OFFSET >= MAX_OPEN_FILES)
+    int slot = AllocateFid();
+    if (slot < 0)
     {
       DEBUG('p', "Too many files open.\n");
       return false;
     }
 
-    char* fileName = &machine->mainMemory[ptrFileName];
-    if (fileName == NULL)
+    char fileName[MAX_FILENAME];
+    if (!space->ReadString(ptrFileName, fileName, MAX_FILENAME))
     {
       DEBUG('p', "Could not find file name string reference in memory.\n");
       return false;
@@ -318,10 +620,23 @@ Process::Process(char* n)
       DEBUG('p', "File system could not find the file specified.\n");
       return false;
     }
-    openFileTable[fileCounter] = file;
+    openFileTable[slot] = file;
 
-    machine->WriteRegister(2, fileCounter + FID_OFFSET);
+    machine->WriteRegister(2, slot + FID_OFFSET);
     fileCounter++;
+    return true;
+  }
+
+
+
+  // Find a slot for a new file id: one that holds neither an open file
+  // nor a pipe end.  Returns -1 if they're all in use.
+  int Process::AllocateFid()
+  {
+    for (int slot = 0; slot < MAX_OPEN_FILES; slot++)
+      if (openFileTable[slot] == NULL && pipeTable[slot] == NULL)
+	return slot;
+    return -1;
   }
 
 
@@ -331,14 +646,138 @@ Process::Process(char* n)
   // We just remove it from the list of open files.
   bool Process::FileClose(int fid)
   {
-    if (openFileTable[fid - FID_OFFSET] == NULL) {
+    int slot = fid - FID_OFFSET;
+    if (slot < 0 || slot >= MAX_OPEN_FILES ||
+	(openFileTable[slot] == NULL && pipeTable[slot] == NULL)) {
       DEBUG('p', "Could not find an open file with that id...\n");
       return false;
     }
-    delete openFileTable[fid - FID_OFFSET];
-    fileCounter--; // bug here - not necessarily the next file id...
+    if (pipeTable[slot] != NULL) {
+      ClosePipe(slot);
+      return true;
+    }
+    delete openFileTable[slot];
+    openFileTable[slot] = NULL;
+    fileCounter--;
+    return true;
+  }
+
+
+
+  // Drop this process's reference to the pipe end in "slot", deleting
+  // the pipe if nobody else holds either end.
+  void Process::ClosePipe(int slot)
+  {
+    if (pipeTable[slot] == NULL)
+      return;
+    if (pipeTable[slot]->Close(pipeWriter[slot]))
+      delete pipeTable[slot];
+    pipeTable[slot] = NULL;
+  }
+
+
+
+  // Make a pipe.  The read and write file ids are stored in the two word
+  // array at ptrFids; r2 gets 0, or -1 if we're out of file ids.
+  bool Process::ProcessPipe(int ptrFids)
+  {
+    int fids[2];
+    int readSlot = AllocateFid();
+    int writeSlot = -1;
+
+    machine->WriteRegister(2, -1);
+    if (readSlot < 0) {
+      DEBUG('p', "Too many files open for a pipe.\n");
+      return true;
+    }
+    PipeBuffer* pipe = new PipeBuffer();
+    pipe->Open(FALSE);
+    pipeTable[readSlot] = pipe;		// reserve it while we look for
+    pipeWriter[readSlot] = FALSE;	// the second slot
+    writeSlot = AllocateFid();
+    if (writeSlot < 0) {
+      DEBUG('p', "Too many files open for a pipe.\n");
+      ClosePipe(readSlot);
+      return true;
+    }
+    pipe->Open(TRUE);
+    pipeTable[writeSlot] = pipe;
+    pipeWriter[writeSlot] = TRUE;
+
+    fids[0] = WordToMachine(readSlot + FID_OFFSET);
+    fids[1] = WordToMachine(writeSlot + FID_OFFSET);
+    if (!space->WriteMemory(ptrFids, (char *)fids, sizeof(fids))) {
+      DEBUG('p', "Pipe file id array is not in the address space.\n");
+      ClosePipe(readSlot);
+      ClosePipe(writeSlot);
+      return false;
+    }
+    DEBUG('p', "Pipe: read end %d, write end %d\n", readSlot + FID_OFFSET, writeSlot + FID_OFFSET);
+    machine->WriteRegister(2, 0);
+    return true;
+  }
+
+
+  // Find or make the shared segment called ptrName; r2 gets its id,
+  // or -1.
+  bool Process::SegmentCreate(int ptrName, int size)
+  {
+    char segmentName[MaxSegmentName];
+    if (!space->ReadString(ptrName, segmentName, MaxSegmentName)) {
+      DEBUG('p', "Could not find segment name in memory.\n");
+      return false;
+    }
+    int id = -1;
+    if (strlen(segmentName) > 0 && size > 0)
+      id = space->CreateSegment(segmentName, size);
+    DEBUG('p', "Shared segment %s is %d\n", segmentName, id);
+    machine->WriteRegister(2, id);
+    return true;
+  }
+
+
+  // Map shared segment "id" at virtAddr (0 lets the kernel choose);
+  // r2 gets the address it landed at, or 0.
+  bool Process::SegmentAttach(int id, int virtAddr)
+  {
+    SharedSegment* segment = sharedMemory->Attach(id);
+    int at = -1;
+
+    if (segment != NULL) {
+      at = space->AttachSegment(segment, virtAddr);
+      if (at < 0)
+	sharedMemory->Detach(segment);
+    }
+    DEBUG('p', "Attach shared segment %d at 0x%x: 0x%x\n", id, virtAddr, at);
+    machine->WriteRegister(2, at < 0 ? 0 : at);
+    return true;
+  }
+
+
+  // Unmap the shared segment at virtAddr; r2 gets 0, or -1.
+  bool Process::SegmentDetach(int virtAddr)
+  {
+    bool detached = space->DetachSegment(virtAddr);
+    DEBUG('p', "Detach shared segment at 0x%x: %d\n", virtAddr, detached);
+    machine->WriteRegister(2, detached ? 0 : -1);
     return true;
   }
+
+
+
+  // A process started by Exec gets its own reference to each of its
+  // parent's pipe ends, under the same file ids, so that the parent can
+  // wire up a producer and a consumer before starting them.
+  void Process::InheritPipes(Process* from)
+  {
+    for (int slot = 0; slot < MAX_OPEN_FILES; slot++) {
+      if (from->pipeTable[slot] == NULL)
+	continue;
+      pipeTable[slot] = from->pipeTable[slot];
+      pipeWriter[slot] = from->pipeWriter[slot];
+      pipeTable[slot]->Open(pipeWriter[slot]);
+    }
+  }
   
 
 
@@ -348,90 +787,159 @@ Process::Process(char* n)
 //
 // Need to check if an attempt was made to write to the console...
 //
-// At the moment, we're making an assumption that no other
-// process are running (processes as distinct to threads).
-//
-// Open files should be stored in a global structure with
-// locks. May even be best as the structure used by the producer
-// consumer thing - if we run out of file space then process blocks
-// until another process drops the file via the close method.
-//
-// For now though, assume only one process.
+// Each process has its own table of open files.  The string is copied
+// out of the process's address space first, since its pages needn't be
+// contiguous in physical memory.
 bool Process::FileWrite(int ptrBuffer, int bufferSize, int fid)
 {
-  char *buffer = &machine->mainMemory[ptrBuffer];
+  if (bufferSize < 0)
+  {
+      DEBUG('p', "Cannot write a negative number of bytes.\n");
+      return false;
+  }
+
+  int slot = fid - FID_OFFSET;
+  if (slot >= 0 && slot < MAX_OPEN_FILES && pipeTable[slot] != NULL)
+    return PipeWrite(ptrBuffer, bufferSize, slot);
 
-  if (buffer == NULL)
+  char *buffer = new char[bufferSize + 1];
+  if (!space->ReadMemory(ptrBuffer, buffer, bufferSize))
   {
       DEBUG('p', "Cannot find string to write.\n");
+      delete [] buffer;
       return false;    
   }
+  buffer[bufferSize] = '\0';		// for the DEBUG message
 
   DEBUG('p', "Attempting to write %s to file %d\n", buffer, fid);
   if (fid == ConsoleOutput)
   {
     if (console == NULL) console = new SynchConsole(NULL, NULL);
-    console->WriteLine(buffer, bufferSize + 1);
+    console->WriteLine(buffer, bufferSize);
   } 
   else if (fid == ConsoleInput)
     {
       DEBUG('p', "Cannot write to console input.\n");
+      delete [] buffer;
       return false;
     } 
   else
   {
-    OpenFile* file = openFileTable[fid - FID_OFFSET];
-    if (file == NULL) {
+    if (slot < 0 || slot >= MAX_OPEN_FILES || openFileTable[slot] == NULL) {
        DEBUG('p', "File does not exist!\n");
+       delete [] buffer;
        return false;
     }
-    file->Write(buffer, bufferSize + 1);
+    openFileTable[slot]->Write(buffer, bufferSize);
   }
+  delete [] buffer;
   return true;
 }
 
 
 
-// Read a string from file (or stdin) and put it back into machine memory.
-//
-// NOTE: buffersize is incremented by one so we can collect newlines from the stdin.
+// Read up to bufferSize bytes from a file (or stdin) into machine memory,
+// returning the number actually read.  Nothing is NUL terminated; stdin
+// blocks until all bufferSize bytes have been typed.
 bool Process::FileRead(int ptrBuffer, int bufferSize, int fid)
 {
-  if (bufferSize == 0)
+  if (bufferSize <= 0)
     {
-      DEBUG('p', "Cannot read zero bytes.\n");
+      DEBUG('p', "Cannot read %d bytes.\n", bufferSize);
       return false;
     }
 
-  char *buffer = (char *)malloc(sizeof(char *) * (bufferSize +1));
+  int slot = fid - FID_OFFSET;
+  if (slot >= 0 && slot < MAX_OPEN_FILES && pipeTable[slot] != NULL)
+    return PipeRead(ptrBuffer, bufferSize, slot);
+
+  char *buffer = new char[bufferSize];
+  int len;
   DEBUG('p', "Attempting to read %d bytes from file %d\n", bufferSize, fid);
   
   if (fid == ConsoleInput)
   {
     // Get the console and read from it.
     if (console == NULL) console = new SynchConsole(NULL, NULL);
-    console->ReadLine(buffer, bufferSize + 1);
+    console->ReadLine(buffer, bufferSize);
+    len = bufferSize;
   }
   else if (fid == ConsoleOutput)
   {
     // Can't read from console output. 
     DEBUG('p', "Cannot read from console output.\n");
+    delete [] buffer;
     return false;
   }
   else 
   {
     // Read bytes from the file.
-    OpenFile* file = openFileTable[fid - FID_OFFSET];
-    if (file == NULL) {
+    if (slot < 0 || slot >= MAX_OPEN_FILES || openFileTable[slot] == NULL) {
       DEBUG('p', "File does not exist!\n");
+      delete [] buffer;
       return false;
     }
-    file->Read(buffer, bufferSize + 1);
+    len = openFileTable[slot]->Read(buffer, bufferSize);
   }
-  int len = strlen(buffer);
-  DEBUG('p', "Read string %s with len %d\n", buffer, len);
 
-  strcpy(&machine->mainMemory[ptrBuffer], buffer);
+  bool copied = space->WriteMemory(ptrBuffer, buffer, len);
+  delete [] buffer;
+  if (!copied) {
+    DEBUG('p', "Read buffer is not in the address space.\n");
+    return false;
+  }
+  DEBUG('p', "Read %d bytes\n", len);
+  machine->WriteRegister(2, len);
+  return true;
+}
+
+
+
+// Write to a pipe.  Unlike files, exactly "bufferSize" bytes are sent --
+// pipes carry binary data, not null terminated strings.  The number of
+// bytes written goes in r2; it's short only if the read end was closed.
+bool Process::PipeWrite(int ptrBuffer, int bufferSize, int slot)
+{
+  if (pipeWriter[slot] == FALSE)
+  {
+    DEBUG('p', "Cannot write to the read end of a pipe.\n");
+    return false;
+  }
+
+  char *buffer = new char[bufferSize];
+  if (!space->ReadMemory(ptrBuffer, buffer, bufferSize))
+  {
+    DEBUG('p', "Cannot find data to write to pipe.\n");
+    delete [] buffer;
+    return false;
+  }
+  int written = pipeTable[slot]->Write(buffer, bufferSize);
+  delete [] buffer;
+  machine->WriteRegister(2, written);
+  return true;
+}
+
+
+
+// Read from a pipe.  Waits until at least one byte is available, then
+// returns what there is, up to "bufferSize" bytes; r2 gets the count,
+// 0 at end of file.
+bool Process::PipeRead(int ptrBuffer, int bufferSize, int slot)
+{
+  if (pipeWriter[slot] == TRUE || bufferSize < 0)
+  {
+    DEBUG('p', "Cannot read from the write end of a pipe.\n");
+    return false;
+  }
+
+  char *buffer = new char[bufferSize];
+  int len = pipeTable[slot]->Read(buffer, bufferSize);
+  bool copied = space->WriteMemory(ptrBuffer, buffer, len);
+  delete [] buffer;
+  if (!copied) {
+    DEBUG('p', "Read buffer is not in the address space.\n");
+    return false;
+  }
   machine->WriteRegister(2, len);
   return true;
 }
@@ -458,22 +966,27 @@ bool Process::ProcessFork(int funcPtr)
 {
   DEBUG('p', "Forking, arg 0x%x \n", funcPtr);
 
-  threadCount++;
-
   char* tname = (char *)malloc(sizeof(char) * (16 + strlen(this->name)));
-  sprintf(tname, "Thread - %s %d", this->name, threadCount);
-  Thread* thread = new Thread(tname);
+  sprintf(tname, "Thread - %s %d", this->name, threadCount + 1);
+  Thread* thread = threadPool->Get(tname);
 
   // Use the current thread address space
   // and create a new stack within the space...
   thread->space = currentThread->space;
-  if (false == thread->space->CreateStack())
+  thread->process = this;
+  thread->processUsage = usage;
+  thread->userStackTop = thread->space->CreateStack();
+  if (thread->userStackTop < 0)
   {
-    delete thread;
+    threadPool->Put(thread);
     DEBUG('p', "Create stack failed - not enough memory available.\n");
     return false;
   }
 
+  processTableLock->Acquire();
+  threadCount++;
+  liveThreads++;
+  processTableLock->Release();
   this->threads->Append(thread);
 
   thread->Fork(ForkUserThread, funcPtr);
@@ -498,5 +1011,86 @@ void Process::ProcessYield()
   DEBUG('p', "Thread yielding %s\n", currentThread->getName());
   currentThread->Yield();
 }
+
+
+// Move the break by "increment" bytes; r2 gets the old break, or -1.
+bool Process::ProcessSbrk(int increment)
+{
+  int oldBrk = space->Sbrk(increment);
+
+  DEBUG('p', "Sbrk %d: 0x%x\n", increment, oldBrk);
+  machine->WriteRegister(2, oldBrk);
+  return true;
+}
+
+
+// Set the calling thread's stride scheduling tickets; r2 gets the old
+// number, or -1 if "tickets" is out of range.
+bool Process::ProcessSetTickets(int tickets)
+{
+  if (tickets < 1 || tickets > MaxTickets) {
+    machine->WriteRegister(2, -1);
+    return true;
+  }
+  DEBUG('p', "Thread %s: %d tickets\n", currentThread->getName(), tickets);
+  machine->WriteRegister(2, currentThread->getTickets());
+  currentThread->setTickets(tickets);
+  return true;
+}
+
+
+// Copy the CPU usage of the calling thread, or of the whole process, to
+// the Usage at ptrUsage; r2 gets 0, or -1 if "which" is neither.
+bool Process::ProcessGetUsage(int ptrUsage, int which)
+{
+  CpuUsage* from;
+  int words[4];
+
+  if (which == UsageThread)
+    from = &currentThread->usage;
+  else if (which == UsageProcess)
+    from = usage;
+  else {
+    machine->WriteRegister(2, -1);
+    return true;
+  }
+  words[0] = WordToMachine(from->userTicks);
+  words[1] = WordToMachine(from->systemTicks);
+  words[2] = WordToMachine(from->blockedTicks);
+  words[3] = WordToMachine(from->switches);
+  if (!space->WriteMemory(ptrUsage, (char *)words, sizeof(words))) {
+    DEBUG('p', "Usage is not in the address space.\n");
+    return false;
+  }
+  machine->WriteRegister(2, 0);
+  return true;
+}
+
+
+// Sleep on the word at virtAddr if it still holds "expected"; r2 gets 0
+// after a wakeup, or -1 if the word had changed.  A bad or unaligned
+// address kills the process, like any other bad pointer.
+bool Process::FutexWait(int virtAddr, int expected)
+{
+  int result = futexTable->Wait(space, virtAddr, expected);
+
+  if (result < 0) {
+    DEBUG('p', "Wait on a bad address 0x%x\n", virtAddr);
+    return false;
+  }
+  machine->WriteRegister(2, result == 0 ? 0 : -1);
+  return true;
+}
+
+
+// Wake up to "count" threads waiting on virtAddr; r2 gets how many.
+bool Process::FutexWake(int virtAddr, int count)
+{
+  int woken = futexTable->Wake(space, virtAddr, count);
+
+  DEBUG('p', "Wake 0x%x: %d of %d\n", virtAddr, woken, count);
+  machine->WriteRegister(2, woken);
+  return true;
+}
   
 #endif
@@ -0,0 +1,111 @@
+// FutexTable
+//
+// Kernel wait queues for user-level synchronization, in the style of
+// Linux futexes.  A user program keeps its lock or counter in an
+// ordinary word of its own memory and only traps when it has to block
+// (Wait) or when somebody might be blocked (Wake), so the uncontended
+// case costs no system call at all.
+//
+// Queues are keyed by (address space, virtual address), so a futex
+// word is shared by the threads of one process.  Rather than allocate a
+// queue per word, each word hashes to one of a fixed set of chains and
+// Wake picks out the waiters on its word, unlinking them in place.
+//
+// Like the semaphore code, this relies on interrupts being disabled to
+// make checking the word and going to sleep atomic: a Wake can't slip
+// in between, so no wakeup is lost.
+
+#ifdef CHANGED
+#include "copyright.h"
+#include "futex.h"
+#include "system.h"
+#include "addrspace.h"
+
+// A thread blocked in Wait.  It lives on the waiting thread's own
+// stack, and carries its own link, so waiting never allocates.
+class FutexWaiter {
+ public:
+  FutexWaiter(AddrSpace *s, int addr)
+    : link(this) { space = s; virtAddr = addr; thread = currentThread; }
+
+  AddrSpace *space;
+  int virtAddr;
+  Thread *thread;
+  QueueLink link;
+};
+
+
+FutexTable::FutexTable()
+{
+  for (int i = 0; i < FutexBuckets; i++)
+    buckets[i] = new Queue;
+}
+
+
+FutexTable::~FutexTable()
+{
+  for (int i = 0; i < FutexBuckets; i++)
+    delete buckets[i];
+}
+
+
+int FutexTable::Hash(AddrSpace *space, int virtAddr)
+{
+  unsigned int key = (unsigned int) virtAddr ^ (unsigned int) (long) space;
+
+  return (key / sizeof(int)) % FutexBuckets;
+}
+
+
+// If the word at "virtAddr" still holds "expected", sleep until a Wake
+// on the same word.  The caller should re-check the word when we
+// return, since another thread may have got there first.
+int FutexTable::Wait(AddrSpace *space, int virtAddr, int expected)
+{
+  FutexWaiter waiter(space, virtAddr);
+  int value;
+
+  if ((virtAddr & (sizeof(int) - 1)) != 0)
+    return -1;
+
+  IntStatus oldLevel = interrupt->SetLevel(IntOff);
+  if (!space->ReadMemory(virtAddr, (char *) &value, sizeof(int))) {
+    (void) interrupt->SetLevel(oldLevel);
+    return -1;
+  }
+  if ((int) WordToHost(value) != expected) {
+    (void) interrupt->SetLevel(oldLevel);
+    return 1;
+  }
+
+  buckets[Hash(space, virtAddr)]->Append(&waiter.link);
+  currentThread->Sleep();
+  (void) interrupt->SetLevel(oldLevel);
+  return 0;
+}
+
+
+// Wake up to "count" of the threads waiting on "virtAddr", oldest
+// first.  Waiters on other words that share the chain stay where they
+// are.
+int FutexTable::Wake(AddrSpace *space, int virtAddr, int count)
+{
+  Queue *chain = buckets[Hash(space, virtAddr)];
+  QueueLink *link, *next;
+  int woken = 0;
+
+  IntStatus oldLevel = interrupt->SetLevel(IntOff);
+  for (link = chain->Head(); link != NULL && woken < count; link = next) {
+    FutexWaiter *waiter = (FutexWaiter *) link->item;
+
+    next = link->next;			// Unlink clears it
+    if (waiter->space == space && waiter->virtAddr == virtAddr) {
+      chain->Unlink(link);
+      scheduler->ReadyToRun(waiter->thread);
+      woken++;
+    }
+  }
+  (void) interrupt->SetLevel(oldLevel);
+  return woken;
+}
+#endif
@@ -0,0 +1,32 @@
+// Header file for futex.cc (see that file for documentation).
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "copyright.h"
+#include "queue.h"
+
+class AddrSpace;
+
+#define FutexBuckets	31	// hash chains; prime, to spread word addresses
+
+class FutexTable {
+  public:
+    FutexTable();
+    ~FutexTable();
+
+    int Wait(AddrSpace *space, int virtAddr, int expected);
+					// sleep if the word still holds
+					// "expected": 0 once woken, 1 if it
+					// didn't, -1 on a bad address
+    int Wake(AddrSpace *space, int virtAddr, int count);
+					// wake up to "count" waiters on the
+					// word; returns how many woke
+
+  private:
+    Queue *buckets[FutexBuckets];	// FutexWaiters, FIFO within a chain
+
+    int Hash(AddrSpace *space, int virtAddr);
+};
+
+#endif // FUTEX_H
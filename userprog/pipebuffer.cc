@@ -0,0 +1,167 @@
+// PipeBuffer
+//
+// A one-way byte stream between user threads, possibly in different
+// processes.  Data is held in a fixed size kernel ring buffer rather
+// than on the simulated disk.
+//
+// Same shape as the BoundedBuffer in threads/boundedbuffer.cc: one lock
+// and two condition variables, except that whole runs of bytes are
+// moved under the lock at a time, not single characters.  Each end is
+// reference counted, so a reader sees end of file once all the write
+// descriptors are closed, and a writer stops once all the readers are.
+//
+// A sibling thread may close both ends while another thread of the same
+// process is still blocked in Read or Write.  So the pipe counts the
+// threads inside those, and whichever is last out -- the closer or the
+// blocked thread -- deletes it.
+
+#ifdef CHANGED
+#include "copyright.h"
+#include "pipebuffer.h"
+#include "system.h"
+
+
+PipeBuffer::PipeBuffer()
+{
+  mutex = new Lock("pipe mutex lock");
+  empty = new Condition("pipe EMPTY");
+  full = new Condition("pipe FULL");
+  buffer = new char[PipeCapacity];
+  in = 0;
+  out = 0;
+  itemCount = 0;
+  readers = 0;
+  writers = 0;
+  users = 0;
+}
+
+
+PipeBuffer::~PipeBuffer()
+{
+  ASSERT(readers == 0 && writers == 0 && users == 0);
+  delete [] buffer;
+  delete mutex;
+  delete empty;
+  delete full;
+}
+
+
+// Copy "size" bytes into the buffer, blocking on "full" whenever there
+// is no room.  Readers are signalled after each run of bytes rather
+// than once per byte.
+//
+// Returns the number of bytes written, which is less than "size" only
+// if the read end was closed.
+int PipeBuffer::Write(char *data, int size)
+{
+  int written = 0;
+
+  mutex->Acquire();
+  users++;
+  while (written < size && readers > 0) {
+    while (itemCount == PipeCapacity && readers > 0)
+      full->Wait(mutex);
+    if (readers == 0)
+      break;
+
+    // copy up to the end of the free space, or the end of the array,
+    // whichever comes first
+    int chunk = min(size - written, PipeCapacity - itemCount);
+    chunk = min(chunk, PipeCapacity - in);
+    bcopy(data + written, &buffer[in], chunk);
+    in = (in + chunk) % PipeCapacity;
+    itemCount += chunk;
+    written += chunk;
+
+    DEBUG('p', "Pipe: %s wrote %d bytes, %d buffered\n", currentThread->getName(), chunk, itemCount);
+    empty->Broadcast(mutex);
+  }
+  bool unused = Leave();
+  mutex->Release();
+  if (unused)
+    delete this;
+  return written;
+}
+
+
+// Copy up to "size" bytes out of the buffer.  Blocks only while the
+// buffer is empty and a writer might still fill it; returns whatever is
+// there rather than waiting for all "size" bytes.
+//
+// Returns the number of bytes read, 0 at end of file.
+int PipeBuffer::Read(char *data, int size)
+{
+  int taken = 0;
+
+  mutex->Acquire();
+  users++;
+  while (itemCount == 0 && writers > 0)
+    empty->Wait(mutex);
+
+  while (taken < size && itemCount > 0) {
+    int chunk = min(size - taken, itemCount);
+    chunk = min(chunk, PipeCapacity - out);
+    bcopy(&buffer[out], data + taken, chunk);
+    out = (out + chunk) % PipeCapacity;
+    itemCount -= chunk;
+    taken += chunk;
+  }
+
+  DEBUG('p', "Pipe: %s read %d bytes, %d buffered\n", currentThread->getName(), taken, itemCount);
+  if (taken > 0)
+    full->Broadcast(mutex);
+  bool unused = Leave();
+  mutex->Release();
+  if (unused)
+    delete this;
+  return taken;
+}
+
+
+// The calling thread is done in Read or Write.  The mutex must be held.
+//
+// Returns TRUE if both ends were closed while it was inside, so that it
+// is the one to delete the pipe -- once it has released the mutex.
+bool PipeBuffer::Leave()
+{
+  ASSERT(users > 0);
+  users--;
+  return (readers == 0 && writers == 0 && users == 0);
+}
+
+
+// A new descriptor refers to one end of the pipe.
+void PipeBuffer::Open(bool writer)
+{
+  mutex->Acquire();
+  if (writer)
+    writers++;
+  else
+    readers++;
+  mutex->Release();
+}
+
+
+// A descriptor on one end of the pipe has been closed.  When the last
+// reader or writer goes, wake up anyone blocked on the other end so
+// they can see it.
+//
+// Returns TRUE if the caller should delete the pipe: both ends are
+// closed and no thread is still inside Read or Write.
+bool PipeBuffer::Close(bool writer)
+{
+  mutex->Acquire();
+  if (writer) {
+    ASSERT(writers > 0);
+    if (--writers == 0)
+      empty->Broadcast(mutex);
+  } else {
+    ASSERT(readers > 0);
+    if (--readers == 0)
+      full->Broadcast(mutex);
+  }
+  bool unused = (readers == 0 && writers == 0 && users == 0);
+  mutex->Release();
+  return unused;
+}
+#endif
@@ -0,0 +1,42 @@
+// Header file for pipebuffer.cc (see that file for documentation).
+
+#ifndef PIPEBUFFER_H
+#define PIPEBUFFER_H
+
+#include "copyright.h"
+#include "synch.h"
+
+#define PipeCapacity 512	// bytes buffered in the kernel per pipe
+
+class PipeBuffer {
+  public:
+    PipeBuffer();
+    ~PipeBuffer();
+
+    int Write(char *data, int size);	// returns bytes written, short
+					// only if every reader has gone
+    int Read(char *data, int size);	// returns bytes read, 0 at
+					// end of file
+
+    void Open(bool writer);		// another descriptor refers to
+					// the read or write end
+    bool Close(bool writer);		// TRUE once both ends are closed
+					// and the pipe can be deleted; if
+					// a thread is still in Read or
+					// Write, it deletes the pipe instead
+
+  private:
+    char *buffer;
+    int in, out;
+    int itemCount;	// bytes currently in the buffer
+    int readers;	// descriptors open on the read end
+    int writers;	// descriptors open on the write end
+    int users;		// threads inside Read or Write
+    Lock *mutex;
+    Condition *empty;	// wait in Read if the buffer is empty
+    Condition *full;	// wait in Write if the buffer is full
+
+    bool Leave();	// a thread is leaving Read or Write
+};
+
+#endif // PIPEBUFFER_H
@@ -7,7 +7,7 @@
 
 extern void InitExceptions();
 extern void InitProcess(Process* process);
-extern void ForkUserThread(int funcPtr);
+extern void ForkUserThread(PtrInt funcPtr);
 extern void IncrementPC();
 
 
@@ -33,10 +33,12 @@ StartProcess(char *filename)
     InitExceptions();
 
     space = new AddrSpace(executable);
+    ASSERT(space->IsLoaded());		// nothing else is running yet, so
+					// it just doesn't fit in memory
   
     currentThread->space = space;
 
-    Process* process = new Process(filename);
+    Process* process = new Process(filename, currentThread);
 
     InitProcess(process);
 
@@ -1,15 +1,34 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
 #include "copyright.h"
 #include "thread.h"
 #include "system.h"
 #include "addrspace.h"
 #include "list.h"
+#include "synch.h"
 #include "openfile.h"
+#include "pipebuffer.h"
 
 #define MAX_OPEN_FILES 100
 #define FID_OFFSET 2 // So there are no clashes with the console file ids...
+#define MAX_PROCESSES 32 // Size of the process table (SpaceIds 0..31)
+#define MAX_FILENAME 128 // Longest path accepted from a user program
 
 void StartProcess(char *filename);
 
+// Print what every process so far did with the CPU, at Halt.
+void ProcessUsageReport();
+
+// What the threads of a process did with the CPU.  Each thread charges
+// this as well as its own CpuUsage (see thread.h).  It is kept after
+// the process has gone, for ProcessUsageReport.
+class ProcessUsage : public CpuUsage {
+ public:
+  ProcessUsage(char* n);
+  char* name;
+  int spaceId;             // -1 until the process is in the table
+};
 
 
 // Process
@@ -19,13 +38,24 @@ void StartProcess(char *filename);
 // 
 class Process {
  public:
-  //Process(char* n, Thread* pThread);
-  Process(char* n);
+  Process(char* n, Thread* pThread);
   ~Process();
 
-  //bool Start();
+  // Finish the calling thread.  When the last thread of the process
+  // exits, the address space is freed and any Join()ers are woken.
+  void ExitProcess(int status);
+
+  // Kill the process after a fault and finish the calling thread.  The
+  // exit status is -1 whatever the threads pass to Exit, and the other
+  // threads exit as soon as they next trap into the kernel.
+  void KillProcess();
+  bool IsKilled() { return killed; }
 
-  bool ExitProcess(int status);
+  // Run a program in a new address space, concurrently with this one.
+  bool ProcessExec(int ptrFileName);
+
+  // Wait for a child started by Exec to exit.
+  bool ProcessJoin(int spaceId);
   
   // Create a file
   bool FileCreate(int ptrFileName);
@@ -42,22 +72,68 @@ class Process {
   // Read a character from a file
   bool FileRead(int ptrBuffer, int bufferSize, int fid);
 
+  // Make a pipe, and write its read and write file ids to ptrFids.
+  bool ProcessPipe(int ptrFids);
+
+  // Shared memory segments - see syscall.h.
+  bool SegmentCreate(int ptrName, int size);
+  bool SegmentAttach(int id, int virtAddr);
+  bool SegmentDetach(int virtAddr);
+
+  // Move the heap's break - see syscall.h.
+  bool ProcessSbrk(int increment);
+
+  // Change the calling thread's share of the CPU - see syscall.h.
+  bool ProcessSetTickets(int tickets);
+
+  // CPU usage of the calling thread or process - see syscall.h.
+  bool ProcessGetUsage(int ptrUsage, int which);
+
   // Fork the process
   bool ProcessFork(int fnPtr);
 
   // Yield the process
   void ProcessYield();
+
+  // Futex-style wait and wake on a word of user memory - see syscall.h.
+  bool FutexWait(int virtAddr, int expected);
+  bool FutexWake(int virtAddr, int count);
+
+  int GetSpaceId() { return spaceId; }
+  void SetSpaceId(int id) { spaceId = id; }
+  char* getName() { return name; }
+  ProcessUsage* GetUsage() { return usage; }
     
 
  private:
-    int processNumber;
+    int spaceId;             // index into the process table
     char* name;
     Thread* processThread;
     List* threads;
-    int threadCount;
+    int threadCount;         // number of threads forked so far
     int fileCounter;
-    
+    AddrSpace* space;        // shared by all the threads of the process
+    ProcessUsage* usage;     // outlives us, once we're in the table
+
+    // Exec/Join bookkeeping -- protected by the process table lock
+    Process* parent;         // who Exec'd us, NULL once the parent exits
+    int liveThreads;         // main thread plus forked threads still running
+    bool exited;             // TRUE once the last thread has exited
+    int exitStatus;          // status passed to Exit by the main thread
+    bool killed;             // TRUE after a fault; exitStatus is then -1
+    Condition* exitCondition;// Join() waits here for "exited"
+
     OpenFile* openFileTable[MAX_OPEN_FILES];
+    PipeBuffer* pipeTable[MAX_OPEN_FILES];   // a file id is a file or a pipe end
+    bool pipeWriter[MAX_OPEN_FILES];   // which end of pipeTable[i] we hold
+
+    int AllocateFid();        // free slot in the tables above, or -1
+    bool PipeWrite(int ptrBuffer, int bufferSize, int slot);
+    bool PipeRead(int ptrBuffer, int bufferSize, int slot);
+    void ClosePipe(int slot); // drop our reference to a pipe end
+    void InheritPipes(Process* from); // Exec'd children share our pipes
+    void ReleaseResources();  // free the address space and open files
+    void OrphanChildren();    // we're exiting; nobody will Join our children
 };
 
 #endif
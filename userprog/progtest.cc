@@ -24,8 +24,8 @@ static Semaphore *writeDone;
 // 	Wake up the thread that requested the I/O.
 //----------------------------------------------------------------------
 
-static void ReadAvail(int arg) { readAvail->V(); }
-static void WriteDone(int arg) { writeDone->V(); }
+static void ReadAvail(PtrInt arg) { readAvail->V(); }
+static void WriteDone(PtrInt arg) { writeDone->V(); }
 
 //----------------------------------------------------------------------
 // ConsoleTest
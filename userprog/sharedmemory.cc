@@ -0,0 +1,145 @@
+// SharedMemory
+//
+// Named segments of physical memory that several user processes can
+// map into their address spaces at once, so that they can exchange data
+// without copying it through a file or a pipe.
+//
+// A segment is just a set of frames taken from "memoryMap".  Attaching
+// it to an address space points some of that space's page table entries
+// at the segment's frames (see AddrSpace::AttachSegment); the frames go
+// back to "memoryMap" when the last address space holding a reference,
+// by attaching or by creating, lets go.
+
+#ifdef CHANGED
+#include "copyright.h"
+#include "sharedmemory.h"
+#include "synch.h"
+#include "system.h"
+
+
+// Take "pages" zeroed frames from the free frame map.  If there aren't
+// enough, "frames" is left NULL (see IsAllocated).
+SharedSegment::SharedSegment(char *segmentName, int pages)
+{
+  strncpy(name, segmentName, MaxSegmentName);
+  name[MaxSegmentName - 1] = '\0';
+  numPages = pages;
+  refCount = 0;
+  frames = NULL;
+
+  if (memoryMap->NumClear() < numPages)
+    return;
+  frames = new int[numPages];
+  for (int i = 0; i < numPages; i++) {
+    frames[i] = memoryMap->Find();
+    bzero(&machine->mainMemory[frames[i] * PageSize], PageSize);
+  }
+}
+
+
+SharedSegment::~SharedSegment()
+{
+  if (frames == NULL)
+    return;
+  for (int i = 0; i < numPages; i++)
+    memoryMap->Clear(frames[i]);
+  delete [] frames;
+}
+
+
+SharedMemory::SharedMemory()
+{
+  lock = new Lock("shared memory lock");
+  for (int i = 0; i < MaxSegments; i++)
+    segments[i] = NULL;
+}
+
+
+SharedMemory::~SharedMemory()
+{
+  for (int i = 0; i < MaxSegments; i++)
+    delete segments[i];
+  delete lock;
+}
+
+
+// Return the id of the segment called "name", making it if it doesn't
+// exist yet.  A new segment is "size" bytes, rounded up to whole pages;
+// an existing one keeps its size.
+//
+// "held" is the caller's table of segments it has Created, by id.  The
+// caller's first Create of a segment takes a reference and records it
+// there; it is given back with Detach when the caller goes away.
+// Without it, the id could be freed and reused for another segment
+// before the caller got round to attaching it.
+//
+// Returns -1 if the table is full or there isn't enough free memory.
+int SharedMemory::Create(char *name, int size, SharedSegment **held)
+{
+  int id, freeId = -1;
+
+  lock->Acquire();
+  for (id = 0; id < MaxSegments; id++) {
+    if (segments[id] == NULL) {
+      if (freeId < 0)
+	freeId = id;
+    } else if (!strncmp(segments[id]->getName(), name, MaxSegmentName - 1)) {
+      break;
+    }
+  }
+
+  if (id == MaxSegments) {
+    id = freeId;
+    if (id >= 0) {
+      SharedSegment *segment = new SharedSegment(name, divRoundUp(size, PageSize));
+      if (segment->IsAllocated()) {
+	segments[id] = segment;
+	DEBUG('a', "Created shared segment %s (%d), %d pages\n", name, id, segment->NumPages());
+      } else {
+	DEBUG('a', "Not enough free frames for shared segment %s\n", name);
+	delete segment;
+	id = -1;
+      }
+    }
+  }
+  if (id >= 0 && held[id] == NULL) {
+    held[id] = segments[id];
+    held[id]->refCount++;
+  }
+  lock->Release();
+  return id;
+}
+
+
+// An address space is about to map segment "id".
+SharedSegment *SharedMemory::Attach(int id)
+{
+  SharedSegment *segment = NULL;
+
+  lock->Acquire();
+  if (id >= 0 && id < MaxSegments && segments[id] != NULL) {
+    segment = segments[id];
+    segment->refCount++;
+  }
+  lock->Release();
+  return segment;
+}
+
+
+// An address space has unmapped "segment", or is giving back the
+// reference Create took for it.  On the last reference the name goes
+// away and the frames are freed.
+void SharedMemory::Detach(SharedSegment *segment)
+{
+  lock->Acquire();
+  ASSERT(segment->refCount > 0);
+  if (--segment->refCount == 0) {
+    for (int id = 0; id < MaxSegments; id++)
+      if (segments[id] == segment)
+	segments[id] = NULL;
+    DEBUG('a', "Freeing shared segment %s\n", segment->getName());
+    delete segment;
+  }
+  lock->Release();
+}
+#endif
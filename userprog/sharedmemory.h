@@ -0,0 +1,58 @@
+// Header file for sharedmemory.cc (see that file for documentation).
+
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include "copyright.h"
+#include "utility.h"
+
+class Lock;
+
+#define MaxSegments	16	// named segments in the system at once
+#define MaxSegmentName	32	// longest segment name, including the null
+
+// A run of physical frames that can be mapped into several address
+// spaces at once.
+class SharedSegment {
+  public:
+    SharedSegment(char *segmentName, int pages);  // allocate the frames
+    ~SharedSegment();				   // free the frames
+
+    bool IsAllocated() { return frames != NULL; }
+    char *getName() { return name; }
+    int NumPages() { return numPages; }
+    int Frame(int page) { return frames[page]; }
+
+  private:
+    char name[MaxSegmentName];
+    int numPages;
+    int *frames;	// physical page backing each page of the segment
+    int refCount;	// attachments, plus address spaces that
+			// Created it and still exist
+
+    friend class SharedMemory;
+};
+
+// The table of named segments.  A segment lives until every address
+// space that attached it has detached and every address space that
+// Created it has gone away.
+class SharedMemory {
+  public:
+    SharedMemory();
+    ~SharedMemory();
+
+    int Create(char *name, int size, SharedSegment **held);
+					// find or make a segment, take a
+					// reference in held[id] if there
+					// isn't one, and return id, or -1
+    SharedSegment *Attach(int id);	// take a reference; NULL if there
+					// is no such segment
+    void Detach(SharedSegment *segment);// drop a reference, freeing the
+					// frames on the last one
+
+  private:
+    Lock *lock;
+    SharedSegment *segments[MaxSegments];
+};
+
+#endif // SHAREDMEMORY_H
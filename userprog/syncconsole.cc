@@ -12,7 +12,9 @@ SynchConsole::SynchConsole(char *readFile, char *writeFile)
   lock = new Lock("Synch console lock");
   readAvail = new Semaphore("Synch console read semaphore",0);
   writeDone = new Semaphore("Synch console write semaphore",0);
-  console = new Console(readFile,writeFile,ReadAvail,WriteDone,0);
+  console = new Console(readFile,writeFile,ReadAvail,WriteDone,0,TRUE);
+  outHead = outCount = 0;
+  inHead = inCount = 0;
 }
 
 //----------------------------------------------------------------------
@@ -22,34 +24,94 @@ SynchConsole::SynchConsole(char *readFile, char *writeFile)
 
 SynchConsole::~SynchConsole()
 {
+  Flush();
   delete console;
   delete lock;
   delete readAvail;
   delete writeDone;
 }
 
+//----------------------------------------------------------------------
+//  SynchConsole::ReadLine()
+//     Read exactly "length" characters.  Buffered input is used first;
+//     after that we wait for the console to deliver another run.  Any
+//     partly written line is flushed first, so that a prompt shows up
+//     before we wait for the answer.
+//----------------------------------------------------------------------
+
 void
 SynchConsole::ReadLine(char *databuf,int length)
 {
   int idx = 0;
   lock->Acquire();              // sole access to the console
-  for (; length>0; length--) {
-    DEBUG('a',"getting char from console\n");
-    readAvail->P();                         // wait for interrupt
-    databuf[idx++] = console->GetChar();    // input one character at a time
+  FlushOutput();
+  while (length > 0) {
+    if (inCount == 0) {
+      DEBUG('a',"getting chars from console\n");
+      readAvail->P();                       // wait for interrupt
+      inHead = 0;
+      inCount = console->GetChars(input, ConsoleBufferSize);
+      continue;
+    }
+    int chunk = min(length, inCount);
+    bcopy(&input[inHead], &databuf[idx], chunk);
+    inHead += chunk;
+    inCount -= chunk;
+    idx += chunk;
+    length -= chunk;
   }
   lock->Release();
 }
 
+//----------------------------------------------------------------------
+//  SynchConsole::WriteLine()
+//     Add "length" characters to the output buffer.  The buffer is
+//     written out whenever it fills, and at the end if a newline went
+//     in.
+//----------------------------------------------------------------------
+
 void
 SynchConsole::WriteLine(char *databuf,int length)
 {
-  int idx = 0;
+  bool newline = FALSE;
   lock->Acquire();              // sole access to the console
-  for (; length>0; length--) {
-    DEBUG('a',"Putting char to console\n");
-    console->PutChar(databuf[idx++]);    // output one character at a time
-    writeDone->P();                      // wait for interrupt
+  for (int idx = 0; idx < length; idx++) {
+    if (outCount == ConsoleBufferSize)
+      FlushOutput();
+    output[(outHead + outCount) % ConsoleBufferSize] = databuf[idx];
+    outCount++;
+    if (databuf[idx] == '\n')
+      newline = TRUE;
   }
+  if (newline)
+    FlushOutput();
+  lock->Release();
+}
+
+void
+SynchConsole::Flush()
+{
+  lock->Acquire();
+  FlushOutput();
   lock->Release();
 }
+
+//----------------------------------------------------------------------
+//  SynchConsole::FlushOutput()
+//     Hand the output buffer to the console -- one transfer, or two if
+//     the data wraps around the end of the ring.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::FlushOutput()
+{
+  while (outCount > 0) {
+    int chunk = min(outCount, ConsoleBufferSize - outHead);
+    DEBUG('a',"Putting %d chars to console\n", chunk);
+    console->PutChars(&output[outHead], chunk);
+    writeDone->P();                      // wait for interrupt
+    outHead = (outHead + chunk) % ConsoleBufferSize;
+    outCount -= chunk;
+  }
+  outHead = 0;
+}
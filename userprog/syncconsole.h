@@ -4,6 +4,11 @@
 //    is asynchronous.
 //
 //    A lock is used to ensure one read or write is done at a time.
+//
+//    Output is collected in a ring buffer and handed to the console in
+//    bulk transfers, one interrupt each, when a line is complete or the
+//    buffer fills (or on Flush).  Input arrives in runs of characters,
+//    which are kept in a second ring until they are read.
 //----------------------------------------------------------------------
 
 #include "console.h"
@@ -12,8 +17,8 @@
 static Semaphore *readAvail;
 static Semaphore *writeDone;
 
-static void ReadAvail(int arg) { readAvail->V(); }
-static void WriteDone(int arg) { writeDone->V(); }
+static void ReadAvail(PtrInt arg) { readAvail->V(); }
+static void WriteDone(PtrInt arg) { writeDone->V(); }
 
 class SynchConsole {
 public:
@@ -21,9 +26,15 @@ public:
   ~SynchConsole();
   void ReadLine(char *databuf,int length);
   void WriteLine(char *databuf,int length);
+  void Flush();			// write out anything buffered
   
 private:
   Console *console;
   Lock *lock;
-};
+  char output[ConsoleBufferSize];	// waiting to be written
+  int outHead, outCount;
+  char input[ConsoleBufferSize];	// read, but not yet asked for
+  int inHead, inCount;
 
+  void FlushOutput();		// the caller holds "lock"
+};
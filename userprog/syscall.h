@@ -29,6 +29,19 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_Pipe		11
+#define SC_SegmentCreate	12
+#define SC_SegmentAttach	13
+#define SC_SegmentDetach	14
+#define SC_Wait		15
+#define SC_Wake		16
+#define SC_Sbrk		17
+#define SC_SetTickets	18
+#define SC_GetUsage	19
+
+/* What GetUsage reports on */
+#define UsageThread	0
+#define UsageProcess	1
 
 #ifndef IN_ASM
 
@@ -108,6 +121,51 @@ int Read(char *buffer, int size, OpenFileId id);
 /* Close the file, we're done reading and writing to it. */
 void Close(OpenFileId id);
 
+/* Create a pipe: a one-way stream of bytes held in kernel memory.
+ * fids[0] is set to the read end and fids[1] to the write end; both
+ * are used with Read, Write and Close like any other open file.
+ * Reading blocks until something has been written, and returns 0 once
+ * every write end is closed.  Programs started with Exec inherit the
+ * caller's pipes, under the same OpenFileIds.
+ * Returns 0, or -1 if the pipe could not be made.
+ */
+int Pipe(OpenFileId fids[2]);
+
+
+/* Shared memory: named segments that several programs can map at once. */
+
+/* A unique identifier for a shared segment */
+typedef int SegmentId;
+
+/* Return the segment called "name", making it "size" bytes long (rounded
+ * up to whole pages) if it doesn't exist yet.  Returns -1 on failure.
+ */
+SegmentId SegmentCreate(char *name, int size);
+
+/* Map the segment into this address space at "addr", which must be page
+ * aligned and not in use, or wherever there is room if "addr" is 0.
+ * Every thread of the program sees the mapping.  Returns the address
+ * used, or 0 on failure.
+ */
+char *SegmentAttach(SegmentId id, char *addr);
+
+/* Unmap the segment attached at "addr".  A segment, and its name, goes
+ * away once every program that attached it has detached and every
+ * program that created it has exited.
+ * Returns 0, or -1 if nothing is attached there.
+ */
+int SegmentDetach(char *addr);
+
+
+
+/* Move the end of this program's heap (the "break") by "increment"
+ * bytes and return the old break, so a positive increment returns the
+ * start of the new memory.  New heap memory reads as zero.  Returns -1
+ * if the heap would shrink below its start or grow past UserHeapSize
+ * (see addrspace.h).  User programs normally use malloc (test/malloc.h)
+ * rather than calling this directly.
+ */
+char *Sbrk(int increment);
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
@@ -124,6 +182,49 @@ void Fork(void (*func)());
  */
 void Yield();		
 
+/* Block until woken by Wake, but only if the word at "addr" still holds
+ * "expected" -- the check and going to sleep are atomic, so a Wake from
+ * another thread can't be missed.  Returns 0 after a wakeup, or -1 at
+ * once if the word had already changed.  Callers should check the word
+ * again either way.
+ *
+ * Together with Wake this lets user programs build locks and condition
+ * variables out of ordinary memory, trapping only when they have to
+ * block or when somebody may be blocked.
+ */
+int Wait(int *addr, int expected);
+
+/* Wake up to "count" threads of this program blocked in Wait on "addr".
+ * Returns how many were woken.
+ */
+int Wake(int *addr, int count);
+
+/* Give the calling thread "tickets" tickets (1 to MaxTickets, see
+ * thread.h).  Under stride scheduling (nachos -sched stride) threads
+ * share the CPU in proportion to their tickets; otherwise this has no
+ * effect.  Returns the old number of tickets, or -1 if "tickets" is out
+ * of range.
+ */
+int SetTickets(int tickets);
+
+/* What a thread, or a process, has done with the CPU, in ticks: running
+ * user code, running in the kernel on its behalf, and blocked (asleep,
+ * not just waiting for the CPU).  "switches" is how many times it gave
+ * up the CPU, whether it blocked, yielded or was preempted.
+ */
+typedef struct {
+    int userTicks;
+    int systemTicks;
+    int blockedTicks;
+    int switches;
+} Usage;
+
+/* Fill in "usage" for the calling thread (UsageThread), or for all the
+ * threads of the calling process so far, including those that have
+ * exited (UsageProcess).  Returns 0, or -1 if "which" is neither.
+ */
+int GetUsage(Usage *usage, int which);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */